@@ -9,7 +9,8 @@
 class MAActionInitialization : public G4VUserActionInitialization
 {
 public:
-  MAActionInitialization(MADetectorConstruction* det, G4String name);
+  MAActionInitialization(MADetectorConstruction* det, G4String name, G4long seed,
+                         G4String phasespace = "", G4String level = "full");
   virtual ~MAActionInitialization();
 
   virtual void BuildForMaster() const;
@@ -18,6 +19,9 @@ public:
 private:
   MADetectorConstruction*   fDet;
   G4String                  foutname;
+  G4long                    fseed;
+  G4String                  fphasespace;  // stage-1 output, empty if off
+  G4String                  flevel;       // output tier
 };
 
 #endif
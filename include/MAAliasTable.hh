@@ -0,0 +1,36 @@
+#ifndef MAAliasTable_h
+#define MAAliasTable_h 1
+
+// std c++ includes
+#include <vector>
+
+/// Walker alias table
+///
+/// Discrete distribution over N bins with arbitrary non-negative weights,
+/// sampled in constant time from a single uniform number. Built with
+/// Vose's variant of the algorithm, immutable afterwards.
+
+class MAAliasTable
+{
+public:
+  MAAliasTable() = default;
+  explicit MAAliasTable(const std::vector<double>& weights);
+
+  // u uniform in [0,1), returns bin index
+  int Sample(double u) const
+  {
+    double x    = u * fProb.size();
+    auto   bin  = static_cast<std::size_t>(x);
+    if(bin >= fProb.size())
+      bin = fProb.size() - 1;
+    return (x - bin < fProb[bin]) ? static_cast<int>(bin) : fAlias[bin];
+  }
+
+  std::size_t size() const { return fProb.size(); }
+
+private:
+  std::vector<double> fProb;   // acceptance probability of bin itself
+  std::vector<int>    fAlias;  // alternative bin
+};
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef MAAncestryIndex_h
+#define MAAncestryIndex_h 1
+
+// std c++ includes
+#include <cstddef>
+#include <vector>
+
+/// Per-event ancestry index
+///
+/// Built once per event from the track and parent ID columns of the track
+/// histories: the position of each track ID and of its parent, so a step
+/// up the ancestry costs constant time. Chain() returns the history of a
+/// track back to the primary. Every link it walks is labelled with the
+/// chain it ended up in and its offset there, so a later walk stops at
+/// the first labelled ancestor and copies the known rest: an ancestor
+/// chain shared by many hits is walked once. Geant4-free; tables are
+/// kept between events and only refilled.
+
+class MAAncestryIndex
+{
+public:
+  MAAncestryIndex() = default;
+
+  void Build(const std::vector<int>& tid, const std::vector<int>& pid);
+
+  // position of a track ID in the columns, -1 if none
+  int Position(int tid) const
+  {
+    return (tid > 0 && tid < (int) fPosition.size()) ? fPosition[tid] : -1;
+  }
+  // position of the parent, -1 for primaries or unknown parents
+  int Parent(int position) const { return fParent[position]; }
+
+  // positions from the track of tid back to its primary, track first
+  const std::vector<int>& Chain(int tid);
+
+  // parent links walked by Chain() since Build()
+  std::size_t GetSteps() const { return fSteps; }
+
+private:
+  std::vector<int>              fPosition;  // by track id, -1 if none
+  std::vector<int>              fParent;    // parent position, -1 if none
+  std::vector<int>              fChainOf;   // by position, chain number, -1 if none
+  std::vector<int>              fOffset;    // by position, offset in that chain
+  std::vector<std::vector<int>> fChains;    // remembered chains
+  std::size_t                   fSteps = 0;
+};
+
+#endif
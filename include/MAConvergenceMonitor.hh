@@ -0,0 +1,51 @@
+#ifndef MAConvergenceMonitor_h
+#define MAConvergenceMonitor_h 1
+
+// std c++ includes
+#include <vector>
+
+#include "G4GenericMessenger.hh"
+#include "globals.hh"
+
+struct MAIsotope;
+
+/// Convergence-driven run termination
+///
+/// Target isotopes, each by (Z, A, volume code), are added with
+/// /MA/run/target; /MA/run/targetPrecision sets the relative statistical
+/// error at which the run stops (0 switches the monitor off). Each worker
+/// sums the weighted per-event counts of the targets and folds them into
+/// shared totals every /MA/run/checkInterval events. Once every target has
+/// reached the precision, all workers soft-abort after their current event,
+/// so the end-of-run merging proceeds as usual. The relative error treats
+/// events as independent, sqrt(N/(N-1) (sum x^2 - (sum x)^2 / N)) / sum x,
+/// and is only tested after /MA/run/minEvents events, with at least
+/// /MA/run/minTargetEvents of them holding the target.
+///
+/// One instance, owned by the master run action, holds the commands; the
+/// settings are shared by all threads and only read during a run.
+
+class MAConvergenceMonitor
+{
+public:
+  MAConvergenceMonitor();
+  ~MAConvergenceMonitor();
+
+  // master: reset the shared totals
+  static void BeginOfRun();
+  // worker: count this event; true once the run should stop
+  static G4bool AddEvent(const std::vector<MAIsotope>& isotopes, G4double weight);
+  // workers fold in their remainder, the master reports
+  static void EndOfRun(G4bool master);
+
+  static G4bool IsActive();
+
+private:
+  void DefineCommands();
+  void AddTarget(const G4String& target);
+  void ClearTargets();
+
+  G4GenericMessenger* fMessenger = nullptr;
+};
+
+#endif
@@ -3,9 +3,16 @@
 
 #include "G4Cache.hh"
 #include "G4GenericMessenger.hh"
+#include "G4ThreeVector.hh"
 #include "G4VUserDetectorConstruction.hh"
 #include "globals.hh"
 
+#include <initializer_list>
+#include <vector>
+
+class G4LogicalVolume;
+class G4Region;
+class G4UserLimits;
 class G4VPhysicalVolume;
 class MALiquidSD;
 
@@ -22,17 +29,51 @@ public:
   void     ExportGeometry(const G4String& file);
   G4double GetWorldSizeZ() { return fvertexZ; }  // inline
   G4double GetWorldExtent() { return fmaxrad; }  // --"--
+  G4double      GetCavernHalfHeight() const { return fcavernhz; }
+  G4ThreeVector GetTankCentre() const { return ftankpos; }
+  G4double      GetTankHalfSide() const { return ftankhside; }
+
+  // parameterised EM showers in the rock region, before initialisation
+  void SetFastShower(G4bool val) { fFastShower = val; }
+
+  // per-region production cut and user limits, "Region value unit"
+  void SetRegionCut(const G4String& args);
+  void SetRegionMaxTime(const G4String& args);
+  void SetRegionMinEkin(const G4String& args);
+  void PrintRegions();
 
 private:
   void DefineCommand();
   void DefineMaterials();
+  void DefineRegions();
+
+  /// Region with its own cut and limits; a negative cut means the default
+  struct RegionSetting
+  {
+    G4Region*     region  = nullptr;
+    G4UserLimits* limits  = nullptr;
+    G4double      cut     = -1.0;
+    G4double      maxTime = DBL_MAX;
+    G4double      minEkin = 0.0;
+  };
+
+  RegionSetting* ParseRegion(const G4String& args, const G4String& category,
+                             G4double& value);
+  void           AddToRegion(const G4String& name, G4LogicalVolume* root,
+                             std::initializer_list<G4LogicalVolume*> volumes);
 
   G4VPhysicalVolume* SetupCryostat();
 
   G4GenericMessenger*                 fDetectorMessenger = nullptr;
+  G4GenericMessenger*                 fRegionMessenger   = nullptr;
+  std::vector<RegionSetting>          fRegions;
   G4double                            fvertexZ           = -1.0;
   G4double                            fmaxrad            = -1.0;
+  G4double                            fcavernhz          = -1.0;
+  G4double                            ftankhside         = -1.0;
+  G4ThreeVector                       ftankpos;
   G4Cache<MALiquidSD*>                fSD                = nullptr;
+  G4bool                              fFastShower        = false;
 };
 
 #endif
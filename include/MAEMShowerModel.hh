@@ -0,0 +1,51 @@
+#ifndef MAEMShowerModel_h
+#define MAEMShowerModel_h 1
+
+#include "G4GenericMessenger.hh"
+#include "G4VFastSimulationModel.hh"
+#include "globals.hh"
+
+#include "MASamplingTable.hh"
+
+/// Parameterised EM showers in the cavern rock
+///
+/// Electrons, positrons and gammas above /MA/fastsim/threshold in the rock
+/// region are not tracked: their energy is deposited on the spot and only
+/// the photonuclear part of the shower, which matters for isotope
+/// production downstream, is emitted. The number of photoneutrons is
+/// Poisson with mean /MA/fastsim/neutronYield per GeV of shower energy
+/// (default from Swanson's rule, 0.0194 Z^0.66 per GeV, at Z = 11 for
+/// standard rock). Their energies follow a pre-tabulated giant-dipole
+/// evaporation spectrum E exp(-E/T), T = /MA/fastsim/temperature, and they
+/// are emitted isotropically from a depth along the shower axis sampled from
+/// the longitudinal Gamma profile, capped at the first boundary of the rock
+/// along the axis, the outer cavern surface or the hall. Switched on with
+/// the -f option of muonargon.
+
+class MAEMShowerModel : public G4VFastSimulationModel
+{
+public:
+  MAEMShowerModel(const G4String& name, G4Region* region);
+  virtual ~MAEMShowerModel();
+
+  virtual G4bool IsApplicable(const G4ParticleDefinition& particle);
+  virtual G4bool ModelTrigger(const G4FastTrack& fastTrack);
+  virtual void   DoIt(const G4FastTrack& fastTrack, G4FastStep& fastStep);
+
+private:
+  void     DefineCommands();
+  void     BuildSpectrum();
+  G4double SampleDepth(G4double energy, G4bool photon) const;
+  G4double DistanceToBoundary(const G4FastTrack& fastTrack, const G4ThreeVector& pos,
+                              const G4ThreeVector& dir) const;
+
+  G4GenericMessenger* fMessenger = nullptr;
+  G4double            fThreshold;
+  G4double            fNeutronYield;  // per GeV of shower energy
+  G4double            fTemperature;
+  G4double            fCriticalEnergy;
+  G4double            fSpectrumT = -1.;  // temperature of fSpectrum
+  MASamplingTable     fSpectrum;         // neutron kinetic energy [MeV]
+};
+
+#endif
@@ -1,72 +1,66 @@
 #ifndef MAEventAction_h
 #define MAEventAction_h 1
 
-#include <algorithm>
-#include <numeric>
 #include <vector>
 
+#include "MAAncestryIndex.hh"
 #include "MALiquidHit.hh"
+#include "MATrackHistory.hh"
 
+#include "G4GenericMessenger.hh"
 #include "G4UserEventAction.hh"
 #include "globals.hh"
 
+class MAIsotopeYields;
+class MALiquidSD;
+
 /// Event action class
 ///
+/// Writes the liquid argon ion hits to the Score ntuple and their track
+/// histories, back to the primary, either as one chain per hit to Traj
+/// ("chain") or deduplicated as a node table per event to Node ("tree"),
+/// chosen with /MA/output/ancestry.
+///
+/// Histories come from the per-thread MATrackHistory, filled by the
+/// tracking action if /MA/output/trackHistory is on, or else from stored
+/// trajectories. The event action owns the MATrackHistory. Chains and
+/// tree nodes are found through an MAAncestryIndex built once per event.
+///
+/// What is written follows the output level of MARunAction: compact output
+/// fills float columns and always uses "tree" ancestry; compact and summary
+/// output add a per-event row to Event, and summary output stops there.
 
 class MAEventAction : public G4UserEventAction
 {
 public:
-  MAEventAction()          = default;
-  virtual ~MAEventAction() = default;
+  MAEventAction(MATrackHistory* history);
+  virtual ~MAEventAction();
 
   virtual void BeginOfEventAction(const G4Event* event);
   virtual void EndOfEventAction(const G4Event* event);
 
 private:
   // methods
+  void                       DefineCommands();
   MALiquidHitsCollection*    GetHitsCollection(G4int hcID,
                                                const G4Event* event) const;
-  G4int                      GeomID(G4String name);
-  void                       makeMap();
-
-  //! Brief description
-  /*!
-   * This filter method retrieves the track history of a specific hit.
-   * Starting with the hit id, the identical track id is found in
-   * the trajectory container with vectors extracted separately,
-   * here the track id and the corresponding track parent id. The parent
-   * id then serves as the new id to look for, all the way back to the
-   * primary particle. That way, only the relevant track history from
-   * start to finish is stored.
-   *
-   * \param[in] item hit id to look for as starting point of history
-   * \param[in] tid vector of all track id's stored in event
-   * \param[in] pid corresponding vector of all parent id's for all tracks in event.
-   */
-  std::vector<int> FilterTrajectories(int item, const std::vector<G4int>& tid,
-                                      const std::vector<G4int>& pid)
-  {
-    int              idx  = 0;
-    int              pidx = 0;
-    std::vector<int> result;
-    auto             it = std::find(tid.begin(), tid.end(), item);
-
-    while(it != tid.end())  // find all links in the chain
-    {
-      idx = (it - tid.begin());  // location of id
-      result.push_back(idx);
-
-      pidx = pid.at(idx);  // next to look for
-      it   = std::find(tid.begin(), tid.end(), pidx);
-    }
-
-    return result;
-  }
+  // double or, in compact output, float column
+  void                       FillReal(G4int ntuple, G4int column, G4double value) const;
 
   // data members
   // hit data
   G4int                     fHID    = -1;
-  std::map<G4String, G4int> lookup;
+  MALiquidSD*               fSD     = nullptr;  // looked up with fHID
+  MAIsotopeYields*          fYields = nullptr;
+  G4GenericMessenger*       fMessenger = nullptr;
+  G4String                  fAncestry  = "chain";  // or "tree"
+  G4bool                    fRecordHistory = false;
+  MATrackHistory*           fHistory       = nullptr;
+  G4bool                    fFloat         = false;  // float columns booked
+
+  // ancestry index, reused between events
+  MAAncestryIndex           fIndex;
+  std::vector<int>          fNodeOf;  // by position, node ID, -1 if none
 };
 
 #endif
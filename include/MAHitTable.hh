@@ -0,0 +1,46 @@
+#ifndef MAHitTable_h
+#define MAHitTable_h 1
+
+// std c++ includes
+#include <cstddef>
+#include <vector>
+
+/// Hit index by track ID
+///
+/// Small open-addressing table with linear probing, used by MALiquidSD to
+/// aggregate the hits of a track. The size is a power of two, doubled
+/// when half full; Clear() empties the occupied slots only, so the table
+/// is kept between events. Geant4-free.
+
+class MAHitTable
+{
+public:
+  MAHitTable() = default;
+
+  // hit index of track tid, inserted as -1 on first call; the caller
+  // then stores the index of the new hit through the reference
+  int& Hit(int tid);
+
+  void Clear();
+
+  std::size_t GetEntries() const { return fUsed.size(); }
+  std::size_t GetSize() const { return fSlots.size(); }
+
+private:
+  struct Slot
+  {
+    int tid = 0;  // 0 marks an empty slot, track IDs start at 1
+    int hit = -1;
+  };
+
+  std::size_t Home(int tid) const
+  {
+    return (std::size_t(tid) * 0x9E3779B1u) & (fSlots.size() - 1);
+  }
+  void Grow();
+
+  std::vector<Slot>        fSlots;  // power-of-two size
+  std::vector<std::size_t> fUsed;   // occupied slots, for Clear()
+};
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef MAIsotopeYields_h
+#define MAIsotopeYields_h 1
+
+// std c++ includes
+#include <ostream>
+#include <vector>
+
+#include "G4VAccumulable.hh"
+#include "MAVolumeCodes.hh"
+#include "globals.hh"
+
+/// Isotope yield accumulable
+///
+/// Weighted counts of nuclei by (Z, N, volume code) in one dense array,
+/// the volume slot being the code + 1 so that the world (-1) has slot 0.
+/// Nuclei beyond kMaxZ or kMaxN go to an overflow count. Nuclei of one
+/// event are correlated, so the error sums the squares of the weighted
+/// per-event counts, added by EndOfEvent(). Also holds the normalisation:
+/// number and weighted number of primary events, aborted events such
+/// as those of an exhausted primary file excluded, and weighted muon column depth
+/// [g/cm2] per volume, from the sensitive detector. Per-thread instances
+/// are merged by the G4AccumulableManager at the end of run.
+
+class MAIsotopeYields : public G4VAccumulable
+{
+public:
+  static constexpr G4int kMaxZ     = 64;  // Gd
+  static constexpr G4int kMaxN     = 100;
+  static constexpr G4int kVolumes  = MAVolumeCodes::kNumCodes + 1;
+
+  MAIsotopeYields(const G4String& name = "IsotopeYields");
+  virtual ~MAIsotopeYields() = default;
+
+  virtual void Merge(const G4VAccumulable& other);
+  virtual void Reset();
+
+  void Fill(G4int Z, G4int A, G4int vcode, G4double weight);
+  void EndOfEvent();  // squares of this event's counts into the error
+  void AddPrimaries(G4double weight) { ++fEvents; fPrimaries += weight; }
+  void AddColumnDepth(G4int vcode, G4double depth) { fDepth[vcode + 1] += depth; }
+
+  G4double GetCount(G4int Z, G4int A, G4int vcode) const;
+  G4double GetError(G4int Z, G4int A, G4int vcode) const;
+  G4int    GetEvents() const { return fEvents; }
+  G4double GetPrimaries() const { return fPrimaries; }
+  G4double GetColumnDepth(G4int vcode) const { return fDepth[vcode + 1]; }
+
+  // table of non-empty entries, per primary and per g/cm2 where available
+  void Print(std::ostream& os) const;
+
+private:
+  static std::size_t Index(G4int Z, G4int N, G4int slot)
+  {
+    return (std::size_t(Z) * (kMaxN + 1) + N) * kVolumes + slot;
+  }
+
+  std::vector<G4double> fSum;   // sum of weights
+  std::vector<G4double> fSum2;  // sum of squared per-event counts
+  std::vector<G4double> fEvent;  // this event's counts
+  std::vector<std::size_t> fTouched;  // their non-zero entries
+  std::vector<G4double> fDepth;
+  G4int                 fEvents    = 0;
+  G4double              fPrimaries = 0.;
+  G4double              fOverflow  = 0.;
+};
+
+#endif
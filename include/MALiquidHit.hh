@@ -27,7 +27,7 @@ class MALiquidHit : public G4VHit
     void SetTID      (G4int    tid)     { fTid    = tid; };
     void SetIonZ     (G4int    tz)      { fZ      = tz; };
     void SetIonA     (G4int    ta)      { fA      = ta; };
-    void SetVName    (G4String nm)      { fName   = nm; };
+    void SetVCode    (G4int    vc)      { fVCode  = vc; };
     void SetTime     (G4double ti)      { fTime   = ti; };
     void SetEdep     (G4double de)      { fEdep   = de; };
     void SetPos      (G4ThreeVector xyz){ fPos    = xyz; };
@@ -36,7 +36,7 @@ class MALiquidHit : public G4VHit
     G4int    GetTID()  const     { return fTid; };
     G4int    GetIonZ()  const    { return fZ; };
     G4int    GetIonA()  const    { return fA; };
-    G4String GetVName() const    { return fName; };
+    G4int    GetVCode() const    { return fVCode; };
     G4double GetTime() const     { return fTime; };
     G4double GetEdep() const     { return fEdep; };
     G4ThreeVector GetPos() const { return fPos; };
@@ -45,7 +45,7 @@ class MALiquidHit : public G4VHit
       G4int         fTid = 0;
       G4int         fZ   = 0;
       G4int         fA   = 0;
-      G4String      fName = "";
+      G4int         fVCode = -1;  // volume code at track vertex
       G4double      fTime = 0.0 ;
       G4double      fEdep = 0.0;
       G4ThreeVector fPos = G4ThreeVector{};
@@ -1,8 +1,12 @@
 #ifndef MALiquidSD_h
 #define MALiquidSD_h 1
 
+#include <vector>
+
+#include "G4GenericMessenger.hh"
 #include "G4VSensitiveDetector.hh"
 
+#include "MAHitTable.hh"
 #include "MALiquidHit.hh"
 
 class G4Step;
@@ -15,6 +19,17 @@ class G4HCofThisEvent;
 /// The hits are accounted in hits in ProcessHits() function which is called
 /// by Geant4 kernel at each step. A hit is created with each step with non zero 
 /// energy deposit.
+///
+/// With /MA/hits/aggregate true, a track keeps one hit instead, across
+/// all sensitive volumes, so there is one row per nucleus with its vertex
+/// volume code: energy deposits are summed while time and position are
+/// those of the first step, or the energy-weighted centroid with
+/// /MA/hits/centroid true. Hits are found by track ID in an MAHitTable
+/// that is reset at each event. Compact and summary
+/// output levels always aggregate.
+///
+/// The column depth [g/cm2] traversed by primaries in each volume is summed
+/// per event, to normalise isotope yields.
 
 class MALiquidSD : public G4VSensitiveDetector
 {
@@ -28,8 +43,25 @@ class MALiquidSD : public G4VSensitiveDetector
     virtual G4bool ProcessHits(G4Step* step, G4TouchableHistory* history);
     virtual void   EndOfEvent(G4HCofThisEvent* hitCollection);
 
+    G4int GetNumberOfHits() const
+    {
+      return (fHitsCollection != nullptr) ? fHitsCollection->entries() : 0;
+    }
+
+    // primary muon column depth of this event, by volume code
+    const std::vector<G4double>& GetColumnDepth() const { return fColumnDepth; }
+
   private:
+    void DefineCommands();
+    MALiquidHit* FindHit(G4int tid, G4bool& created);
+
     MALiquidHitsCollection* fHitsCollection;
+    G4GenericMessenger*     fMessenger = nullptr;
+    G4bool                  fAggregate = false;
+    G4bool                  fAggregateEvent = false;  // this event, with output level
+    G4bool                  fCentroid  = false;
+    MAHitTable              fTable;     // hit index by track ID
+    std::vector<G4double>   fColumnDepth;
 };
 
 #endif
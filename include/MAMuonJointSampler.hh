@@ -0,0 +1,73 @@
+#ifndef MAMuonJointSampler_h
+#define MAMuonJointSampler_h 1
+
+// std c++ includes
+#include <memory>
+#include <vector>
+
+#include "MAAliasTable.hh"
+
+/// Joint muon energy and zenith angle sampler
+///
+/// Tabulates the joint density of (E, cos theta) on a grid which is
+/// logarithmic in energy and linear in cos theta and draws cells with
+/// Walker's alias method. The angular part is MuAngle at the laboratory
+/// depth. The energy part is the MuEnergy shape at the slant depth
+/// depth/cos(theta) of each angular cell, so inclined muons come with
+/// the harder spectrum of the thicker overburden; with the slant
+/// coupling switched off it reduces to MuEnergy at the vertical depth.
+///
+/// Inside a cell cos theta follows the linear interpolation of MuAngle
+/// and the energy a power law matched to the cell edges, both inverted
+/// analytically, so a draw costs three uniform numbers and no search.
+
+class MAMuonJointSampler
+{
+public:
+  struct Config
+  {
+    double depth        = 0.0;   // [km.w.e.]
+    int    energyBins   = 200;   // logarithmic bins in energy
+    int    cosThetaBins = 100;   // linear bins in cos theta
+    bool   slantDepth   = true;  // couple energy to zenith angle
+    bool operator==(const Config& rhs) const
+    {
+      return depth == rhs.depth && energyBins == rhs.energyBins &&
+             cosThetaBins == rhs.cosThetaBins && slantDepth == rhs.slantDepth;
+    }
+  };
+
+  // shared tables for this configuration, built on first request
+  static std::shared_ptr<const MAMuonJointSampler> Get(const Config& cfg);
+
+  explicit MAMuonJointSampler(const Config& cfg);
+
+  // u1, u2, u3 uniform in [0,1); energy in [GeV]
+  void Sample(double u1, double u2, double u3, double& energy, double& costheta) const;
+
+  const Config& GetConfig() const { return fConfig; }
+
+  // table range, as for MAMuonSampler
+  static constexpr double lower_bound    = 1.0;     // energy interval lower bound [GeV]
+  static constexpr double upper_bound    = 3000.0;  // upper bound [GeV]
+  static constexpr double nearhorizontal = 1.0e-5;
+  static constexpr double fullcosangle   = 1.0;
+
+private:
+  struct Cell
+  {
+    double c0;     // lower cos theta edge
+    double dc;     // cos theta width
+    double a0;     // angular density at c0, relative
+    double a1;     // angular density at c0+dc, relative
+    double e0;     // lower energy edge
+    double ratio;  // upper over lower energy edge
+    double expo;   // 1 - power law index inside the cell
+  };
+
+  Config            fConfig;
+  std::vector<Cell> fCells;
+  MAAliasTable      fAlias;
+};
+
+#endif
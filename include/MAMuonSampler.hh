@@ -0,0 +1,47 @@
+#ifndef MAMuonSampler_h
+#define MAMuonSampler_h 1
+
+// std c++ includes
+#include <memory>
+
+#include "MASamplingTable.hh"
+
+/// Muon energy and angle sampler
+///
+/// Precomputed inverse-CDF tables of the MuEnergy and MuAngle functors
+/// for one laboratory depth. Tables are built once per depth and shared
+/// read-only by all worker threads through Get(); a request for a new
+/// depth replaces the cached tables, anybody still holding the previous
+/// ones keeps them alive until done.
+
+class MAMuonSampler
+{
+public:
+  // shared tables for depth [km.w.e.], built on first request
+  static std::shared_ptr<const MAMuonSampler> Get(double depth);
+
+  explicit MAMuonSampler(double depth);
+
+  // u uniform in [0,1)
+  double SampleEnergy(double u) const { return fEnergy.Sample(u); }    // [GeV]
+  double SampleCosTheta(double u) const { return fCosTheta.Sample(u); }
+
+  // normalised energy density [1/GeV]
+  double EnergyDensity(double energy) const { return fEnergy.Density(energy); }
+
+  double GetDepth() const { return fDepth; }
+
+  // table definition
+  static constexpr int    nbins          = 100;     // number of bins
+  static constexpr double lower_bound    = 1.0;     // energy interval lower bound [GeV]
+  static constexpr double upper_bound    = 3000.0;  // upper bound [GeV]
+  static constexpr double nearhorizontal = 1.0e-5;
+  static constexpr double fullcosangle   = 1.0;
+
+private:
+  double          fDepth;
+  MASamplingTable fEnergy;
+  MASamplingTable fCosTheta;
+};
+
+#endif
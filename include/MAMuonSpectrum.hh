@@ -0,0 +1,72 @@
+#ifndef MAMuonSpectrum_h
+#define MAMuonSpectrum_h 1
+
+// std c++ includes
+#include <cmath>
+
+// muon distribution functors, energy and
+// angle relative to z-axis, i.e. third component of G4ThreeVector
+class MuEnergy
+{
+  // data members
+private:
+  double bpar;     // fixed parameter; Mei, Hime, Preprint astro-ph/0512125, Eq.8
+  double gammaMu;  // "
+  double epsMu;    // "
+  double depth;    // laboratory depth [km.w.e.] to be set
+
+public:
+  MuEnergy(double d)
+  : bpar(0.4)
+  , gammaMu(3.77)
+  , epsMu(693.0)
+  , depth(d)
+  {}  // default constructor, fix parameter values
+  ~MuEnergy() {}
+
+  double operator()(double x)
+  {  // energy distribution function
+    double dummy  = (x + epsMu * (1.0 - std::exp(-bpar * depth)));
+    double result = std::exp(-bpar * depth * (gammaMu - 1.0)) * std::pow(dummy, -gammaMu);
+    return result;
+  }
+
+  double shape(double x) const
+  {  // energy dependence only, without the depth dependent normalisation
+    double dummy = (x + epsMu * (1.0 - std::exp(-bpar * depth)));
+    return std::pow(dummy, -gammaMu);
+  }
+};
+
+class MuAngle
+{
+  // data members
+private:
+  double i1, i2, L1,
+    L2;          // fixed parameter; Mei, Hime, Preprint astro-ph/0512125, Eq.3/4
+  double depth;  // laboratory depth [km.w.e.] to be set
+
+public:
+  MuAngle(double d)
+  : i1(8.6e-6)
+  , i2(0.44e-6)
+  , L1(0.45)
+  , L2(0.87)
+  , depth(d)
+  {}  // default constructor, fix parameter values
+  ~MuAngle() {}
+
+  double operator()(double x)
+  {  // cos(theta) distribution function
+    double costheta = x;
+    double sec      = 1.0e5;  // inverse smallest cos theta
+    if(costheta > 1.0e-5)
+      sec = 1.0 / costheta;  // exclude horizontal costheta = 0
+    double dummy  = depth * sec / L1;
+    double dummy2 = depth * sec / L2;
+    double result = (i1 * std::exp(-dummy) + i2 * std::exp(-dummy2)) * sec;
+    return result;
+  }
+};
+
+#endif
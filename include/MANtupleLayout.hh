@@ -0,0 +1,143 @@
+#ifndef MANtupleLayout_h
+#define MANtupleLayout_h 1
+
+// std c++ includes
+#include <cstddef>
+#include <iterator>
+
+#include "CLHEP/Units/SystemOfUnits.h"
+#include "globals.hh"
+
+/// Ntuple layout shared by booking (MARunAction) and filling (MAEventAction)
+///
+/// Each ntuple has an ID in booking order, a column index enum and a column
+/// table in the same order, checked against each other at compile time.
+/// Column types: 'I' int, 'D' double, 'S' string and 'R' real, a double
+/// column in full output and a float column otherwise. Values are written
+/// in the output units below, fixed at compile time.
+
+namespace MANtuple
+{
+  struct Column
+  {
+    const char* name;
+    char        type;
+  };
+
+  struct Layout
+  {
+    const char*   name;
+    const char*   title;
+    const Column* columns;
+    std::size_t   size;
+  };
+
+  // output units
+  constexpr G4double kEnergy     = CLHEP::MeV;
+  constexpr G4double kExcitation = CLHEP::keV;
+  constexpr G4double kTime       = CLHEP::ns;
+  constexpr G4double kLength     = CLHEP::m;   // hit and isotope positions
+  constexpr G4double kVertex     = CLHEP::mm;  // track vertices
+
+  // ntuple IDs
+  enum Id : G4int
+  {
+    kScore,
+    kTraj,
+    kNorm,
+    kNode,
+    kIso,
+    kEvent
+  };
+
+  // ion hits, one row per hit
+  namespace Score
+  {
+    enum : G4int { EventID, HitID, IonZ, IonA, VCode, Edep, Time, X, Y, Z, Weight, NodeID, Size };
+    constexpr Column columns[] = {
+      { "EventID", 'I' }, { "HitID", 'I' },   { "IonZ", 'I' },    { "IonA", 'I' },
+      { "VCode", 'I' },   { "Edep", 'R' },    { "Time", 'R' },    { "Hitxloc", 'R' },
+      { "Hityloc", 'R' }, { "Hitzloc", 'R' }, { "Weight", 'R' },  // event weight
+      { "NodeID", 'I' }  // leaf in Node, tree mode
+    };
+    static_assert(std::size(columns) == Size, "Score layout");
+  }
+
+  // hit track histories, one chain per hit; chain mode
+  namespace Traj
+  {
+    enum : G4int { EventID, HitID, ParentID, PDG, VCode, X, Y, Z, Weight, Size };
+    constexpr Column columns[] = {
+      { "EventID", 'I' }, { "HitID", 'I' },   { "ParentID", 'I' },
+      { "Trjpdg", 'I' },  { "VtxName", 'I' }, { "TrjXVtx", 'R' },
+      { "TrjYVtx", 'R' }, { "TrjZVtx", 'R' }, { "Weight", 'R' }  // event weight
+    };
+    static_assert(std::size(columns) == Size, "Traj layout");
+  }
+
+  // generator normalisation, one row per worker and run;
+  // live time of the sample is the sum over rows
+  namespace Norm
+  {
+    enum : G4int { NEvents, Depth, Area, SolidAngle, Flux, LiveTime, Size };
+    constexpr Column columns[] = {
+      { "NEvents", 'I' },
+      { "Depth", 'D' },       // [km.w.e.]
+      { "Area", 'D' },        // [m2]
+      { "SolidAngle", 'D' },  // [sr]
+      { "Flux", 'D' },        // [1/(cm2 s)]
+      { "LiveTime", 'D' }     // [s]
+    };
+    static_assert(std::size(columns) == Size, "Norm layout");
+  }
+
+  // hit track histories, each track once per event; tree mode
+  namespace Node
+  {
+    enum : G4int { EventID, NodeID, TrackID, ParentID, PDG, VCode, X, Y, Z, Weight, Size };
+    constexpr Column columns[] = {
+      { "EventID", 'I' }, { "NodeID", 'I' },  { "TrackID", 'I' }, { "ParentID", 'I' },
+      { "Trjpdg", 'I' },  { "VtxName", 'I' }, { "TrjXVtx", 'R' }, { "TrjYVtx", 'R' },
+      { "TrjZVtx", 'R' }, { "Weight", 'R' }
+    };
+    static_assert(std::size(columns) == Size, "Node layout");
+  }
+
+  // nuclei at creation, from the stacking action
+  namespace Iso
+  {
+    enum : G4int { EventID, TrackID, IonZ, IonA, Excitation, VCode, Time, X, Y, Z, Creator, Weight, Size };
+    constexpr Column columns[] = {
+      { "EventID", 'I' },    { "TrackID", 'I' }, { "IonZ", 'I' },    { "IonA", 'I' },
+      { "Excitation", 'R' },  // [keV]
+      { "VCode", 'I' },      { "Time", 'R' },    { "IsoXVtx", 'R' }, { "IsoYVtx", 'R' },
+      { "IsoZVtx", 'R' },    { "Creator", 'S' }, { "Weight", 'R' }
+    };
+    static_assert(std::size(columns) == Size, "Iso layout");
+  }
+
+  // per-event scalars, compact and summary output
+  namespace Event
+  {
+    enum : G4int { EventID, NHits, NIsotopes, Edep, Weight, Size };
+    constexpr Column columns[] = {
+      { "EventID", 'I' }, { "NHits", 'I' }, { "NIsotopes", 'I' },
+      { "Edep", 'R' },  // [MeV], sum over hits
+      { "Weight", 'R' }
+    };
+    static_assert(std::size(columns) == Size, "Event layout");
+  }
+
+  // all ntuples, indexed by ID
+  constexpr Layout layouts[] = {
+    { "Score", "Hits", Score::columns, Score::Size },
+    { "Traj", "Trajectories", Traj::columns, Traj::Size },
+    { "Norm", "Normalisation", Norm::columns, Norm::Size },
+    { "Node", "Ancestry nodes", Node::columns, Node::Size },
+    { "Iso", "Isotopes", Iso::columns, Iso::Size },
+    { "Event", "Event summary", Event::columns, Event::Size }
+  };
+  static_assert(std::size(layouts) == kEvent + 1, "ntuple IDs");
+}
+
+#endif
@@ -0,0 +1,127 @@
+#ifndef MAPhiloxEngine_h
+#define MAPhiloxEngine_h 1
+
+// std c++ includes
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+/// Counter-based random number stream
+///
+/// Philox4x32-10 (Salmon et al., SC11): a keyed bijection of a 128 bit
+/// counter. The key is the 64 bit master seed, the upper half of the
+/// counter selects the stream (e.g. run and event ID) and the lower half
+/// counts blocks of four 32 bit words inside the stream. Any stream is
+/// therefore reproducible on its own, independent of what was drawn
+/// before or on which thread. Satisfies UniformRandomBitGenerator.
+
+class MAPhiloxEngine
+{
+public:
+  using result_type = std::uint32_t;
+
+  MAPhiloxEngine(std::uint64_t seed = 0, std::uint64_t stream = 0) { Reset(seed, stream); }
+
+  // restart at the beginning of stream with key seed
+  void Reset(std::uint64_t seed, std::uint64_t stream)
+  {
+    fKey[0] = static_cast<std::uint32_t>(seed);
+    fKey[1] = static_cast<std::uint32_t>(seed >> 32);
+    fCtr[0] = 0;
+    fCtr[1] = 0;
+    fCtr[2] = static_cast<std::uint32_t>(stream);
+    fCtr[3] = static_cast<std::uint32_t>(stream >> 32);
+    fIndex  = 4;  // block not generated yet
+  }
+
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+  result_type operator()()
+  {
+    if(fIndex == 4)
+    {
+      Generate();
+      fIndex = 0;
+    }
+    return fBlock[fIndex++];
+  }
+
+  // uniform in [0,1) with 53 bit resolution
+  double Flat()
+  {
+    std::uint32_t hi = (*this)();
+    std::uint32_t lo = (*this)();
+    return ToDouble(hi, lo);
+  }
+
+  // the next n values of Flat(), same sequence, but whole blocks are
+  // generated in a loop without the per-word buffer bookkeeping
+  void Flat(double* out, std::size_t n)
+  {
+    std::size_t i = 0;
+    for(; i < n && fIndex != 4; ++i)  // rest of the current block
+      out[i] = Flat();
+
+    std::uint64_t block = fCtr[0] | (std::uint64_t(fCtr[1]) << 32);
+    for(; i + 2 <= n; i += 2, ++block)
+    {
+      std::uint32_t ctr[4] = { static_cast<std::uint32_t>(block),
+                               static_cast<std::uint32_t>(block >> 32), fCtr[2], fCtr[3] };
+      std::uint32_t w[4];
+      Block(fKey, ctr, w);
+      out[i]     = ToDouble(w[0], w[1]);
+      out[i + 1] = ToDouble(w[2], w[3]);
+    }
+    fCtr[0] = static_cast<std::uint32_t>(block);
+    fCtr[1] = static_cast<std::uint32_t>(block >> 32);
+
+    for(; i < n; ++i)
+      out[i] = Flat();
+  }
+
+  // single block of the bijection, exposed for batched use
+  static void Block(const std::uint32_t key[2], const std::uint32_t ctr[4],
+                    std::uint32_t out[4])
+  {
+    std::uint32_t k0 = key[0], k1 = key[1];
+    std::uint32_t c0 = ctr[0], c1 = ctr[1], c2 = ctr[2], c3 = ctr[3];
+    for(int round = 0; round < 10; ++round)
+    {
+      std::uint64_t p0 = std::uint64_t(0xD2511F53u) * c0;
+      std::uint64_t p1 = std::uint64_t(0xCD9E8D57u) * c2;
+      std::uint32_t n0 = std::uint32_t(p1 >> 32) ^ c1 ^ k0;
+      std::uint32_t n2 = std::uint32_t(p0 >> 32) ^ c3 ^ k1;
+      c1               = std::uint32_t(p1);
+      c3               = std::uint32_t(p0);
+      c0               = n0;
+      c2               = n2;
+      k0 += 0x9E3779B9u;  // Weyl sequence bump of the key
+      k1 += 0xBB67AE85u;
+    }
+    out[0] = c0;
+    out[1] = c1;
+    out[2] = c2;
+    out[3] = c3;
+  }
+
+private:
+  static double ToDouble(std::uint32_t hi, std::uint32_t lo)
+  {
+    return ((hi >> 5) * 67108864.0 + (lo >> 6)) * (1.0 / 9007199254740992.0);
+  }
+
+  void Generate()
+  {
+    Block(fKey, fCtr, fBlock);
+    if(++fCtr[0] == 0)
+      ++fCtr[1];
+  }
+
+  std::uint32_t fKey[2];
+  std::uint32_t fCtr[4];
+  std::uint32_t fBlock[4];
+  int           fIndex;
+};
+
+#endif
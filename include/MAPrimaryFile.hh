@@ -0,0 +1,97 @@
+#ifndef MAPrimaryFile_h
+#define MAPrimaryFile_h 1
+
+// std c++ includes
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+/// Binary primary-particle file
+///
+/// A fixed-size header followed by a flat array of MAPrimaryRecord, in
+/// Geant4 internal units (MeV, mm, ns). Records are read in place from a
+/// read-only memory map, never parsed or copied as a whole, so files far
+/// larger than memory can be used. Consecutive records with the same
+/// event number make up one primary event. Worker threads advance one
+/// shared atomic cursor over the records, without locking; a thread whose
+/// cursor position is the first record of an event claims that event and
+/// finds its end from the event numbers, so no index is ever built.
+
+struct MAPrimaryRecord
+{
+  std::int32_t  pdg;         // PDG code
+  float         ekin;        // kinetic energy [MeV]
+  float         x, y, z;     // position [mm]
+  float         dx, dy, dz;  // unit momentum direction
+  float         time;        // [ns]
+  float         weight;      // statistical weight
+  std::uint32_t event;       // equal for all records of one event
+};
+
+struct MAPrimaryFileHeader
+{
+  char          magic[8];    // "MAPRIM01"
+  std::uint64_t entries;     // number of records
+  std::uint32_t recordSize;  // sizeof(MAPrimaryRecord)
+  std::uint32_t reserved;
+};
+
+class MAPrimaryFileReader
+{
+public:
+  // shared reader for file name, mapped on first request;
+  // nullptr with error message set on failure
+  static std::shared_ptr<MAPrimaryFileReader> Open(const std::string& name,
+                                                   std::string&       error);
+
+  ~MAPrimaryFileReader();
+  MAPrimaryFileReader(const MAPrimaryFileReader&) = delete;
+  MAPrimaryFileReader& operator=(const MAPrimaryFileReader&) = delete;
+
+  // records [first, last) of the next event, each event handed out
+  // reuse times in a row; false once all are gone
+  bool Claim(std::uint64_t& first, std::uint64_t& last, unsigned reuse = 1);
+
+  const MAPrimaryRecord& operator[](std::uint64_t i) const { return fRecords[i]; }
+
+  std::uint64_t      GetEntries() const { return fEntries; }
+  const std::string& GetName() const { return fName; }
+
+private:
+  MAPrimaryFileReader() = default;
+
+  std::string                fName;
+  void*                      fMap     = nullptr;
+  std::size_t                fMapSize = 0;
+  const MAPrimaryRecord*     fRecords = nullptr;
+  std::uint64_t              fEntries = 0;
+  std::atomic<std::uint64_t> fNext{ 0 };  // next (record, reuse) slot
+};
+
+class MAPrimaryFileWriter
+{
+public:
+  MAPrimaryFileWriter() = default;
+  ~MAPrimaryFileWriter() { Close(); }
+  MAPrimaryFileWriter(const MAPrimaryFileWriter&) = delete;
+  MAPrimaryFileWriter& operator=(const MAPrimaryFileWriter&) = delete;
+
+  // all false on any failed write or seek, and from then on
+  bool Open(const std::string& name);
+  bool Write(const MAPrimaryRecord* records, std::size_t n);
+  bool Flush();  // updates the header, file stays open
+  bool Close();  // finalises the header
+
+  bool          IsOpen() const { return fFile != nullptr; }
+  std::uint64_t GetEntries() const { return fEntries; }
+
+private:
+  std::FILE*    fFile    = nullptr;
+  std::uint64_t fEntries = 0;
+  bool          fGood    = false;
+};
+
+#endif
@@ -2,13 +2,22 @@
 #define MAPrimaryGeneratorAction_h 1
 
 // std c++ includes
-#include <cmath>
-#include <random>
+#include <map>
+#include <memory>
 
+#include "CLHEP/Units/SystemOfUnits.h"
 #include "G4GenericMessenger.hh"
+#include "G4ThreeVector.hh"
 #include "G4VUserPrimaryGeneratorAction.hh"
 #include "globals.hh"
 
+#include "MAAliasTable.hh"
+#include "MAMuonSpectrum.hh"
+#include "MAPhiloxEngine.hh"
+#include "MAPrimaryFile.hh"
+#include "MAPrimarySampler.hh"
+#include "MASamplingTable.hh"
+
 class G4ParticleGun;
 class G4Event;
 class G4ParticleDefinition;
@@ -20,88 +29,151 @@ class MADetectorConstruction;
 // The G4GenericMessenger is used for simple UI
 /// User can select
 /// - the underground laboratory depth in [km.w.e.]
-
-// muon distribution functors, energy and
-// angle relative to z-axis, i.e. third component of G4ThreeVector
-class MuEnergy
-{
-  // data members
-private:
-  double bpar;     // fixed parameter; Mei, Hime, Preprint astro-ph/0512125, Eq.8
-  double gammaMu;  // "
-  double epsMu;    // "
-  double depth;    // laboratory depth [km.w.e.] to be set
-
-public:
-  MuEnergy(double d)
-  : bpar(0.4)
-  , gammaMu(3.77)
-  , epsMu(693.0)
-  , depth(d)
-  {}  // default constructor, fix parameter values
-  ~MuEnergy() {}
-
-  double operator()(double x)
-  {  // energy distribution function
-    double dummy  = (x + epsMu * (1.0 - std::exp(-bpar * depth)));
-    double result = std::exp(-bpar * depth * (gammaMu - 1.0)) * std::pow(dummy, -gammaMu);
-    return result;
-  }
-};
-
-class MuAngle
-{
-  // data members
-private:
-  double i1, i2, L1,
-    L2;          // fixed parameter; Mei, Hime, Preprint astro-ph/0512125, Eq.3/4
-  double depth;  // laboratory depth [km.w.e.] to be set
-
-public:
-  MuAngle(double d)
-  : i1(8.6e-6)
-  , i2(0.44e-6)
-  , L1(0.45)
-  , L2(0.87)
-  , depth(d)
-  {}  // default constructor, fix parameter values
-  ~MuAngle() {}
-
-  double operator()(double x)
-  {  // cos(theta) distribution function
-    double costheta = x;
-    double sec      = 1.0e5;  // inverse smallest cos theta
-    if(costheta > 1.0e-5)
-      sec = 1.0 / costheta;  // exclude horizontal costheta = 0
-    double dummy  = depth * sec / L1;
-    double dummy2 = depth * sec / L2;
-    double result = (i1 * std::exp(-dummy) + i2 * std::exp(-dummy2)) * sec;
-    return result;
-  }
-};
+/// - the master random seed
+/// - the muon charge ratio N(mu+)/N(mu-), optionally importance biased
+/// - importance sampling of the muon energy from a flatter power law
+/// - the primary source, the analytic muon spectrum ("analytic") or a
+///   binary primary file ("file") written by maprimaries
+/// - the vertex mode, a disk on top of the world ("world") or rays
+///   through the cryostat sampled by projected area ("tank")
+/// - the energy-angle sampler, independent inverse-CDF tables ("table")
+///   or the joint alias-method sampler ("alias") and its grid size
+/// - muon bundles, /MA/generator/bundle/
+///
+/// Energy, direction and the world vertex come from the Geant4-independent
+/// MAPrimarySampler, which takes the shared MAMuonSampler/MAMuonJointSampler
+/// tables for the current settings and is replaced whenever they change.
+///
+/// Random numbers come from a counter-based stream keyed on the master
+/// seed and positioned at (run ID, event ID), so every event can be
+/// regenerated on its own, whatever the thread count or scheduling.
+///
+/// In tank mode every muon crosses Tank_phys. Its direction follows the
+/// intensity times the projected area of the cryostat cube, and the
+/// entry point is uniform on the projected cube. The muon starts where
+/// its line enters the cavern rock. The live time of N generated muons
+/// is N / (GetIntegratedFlux() * GetGenerationArea()).
+///
+/// In bundle mode the multiplicity m of each event follows m^-index up
+/// to a maximum. The m-1 further muons are parallel to the first. Their
+/// distance R to its line follows R/(R+R0)^alpha, they have independent
+/// energies, and they start where their line enters the cavern rock. All
+/// of them are primaries of the same G4Event.
+///
+/// Every muon, bundle muons included, draws its charge from the charge
+/// ratio. With a charge bias f, mu- are sampled with fraction f instead
+/// and the primary vertex carries the weight that restores the ratio,
+/// which enriches mu- capture channels at unchanged expectation values.
+///
+/// With the energy bias on, energies are drawn from E^-biasIndex and the
+/// vertex weight includes MuEnergy over the biasing density, see
+/// MAPrimarySampler. The event weight, GetEventWeight(), is the product
+/// of the weights of all muons of the event and is written to the output.
+///
+/// With a primary file, each event takes the next unclaimed event of the
+/// shared memory-mapped file, one primary vertex per record. With reuse
+/// N, every file event is replayed in N consecutive events with their own
+/// random streams, and the record weights are divided by N. Once the file
+/// is exhausted, the run is aborted.
 
 class MAPrimaryGeneratorAction : public G4VUserPrimaryGeneratorAction
 {
 public:
-  MAPrimaryGeneratorAction(MADetectorConstruction* det);
+  MAPrimaryGeneratorAction(MADetectorConstruction* det, G4long seed = 0);
   virtual ~MAPrimaryGeneratorAction();
 
   virtual void GeneratePrimaries(G4Event*);
 
   void     SetDepth(G4double val) { fDepth = val; }
   G4double GetDepth() const { return fDepth; }
+  void     SetSeed(G4long val) { fSeed = val; }
+  G4long   GetSeed() const { return fSeed; }
+
+  // normalisation of the generated sample
+  G4double GetGenerationArea() const { return fGenArea; }  // mean projected area
+  G4double GetSolidAngle() const { return fSolidAngle; }   // [sr]
+  G4double GetIntegratedFlux() const { return fFlux; }     // [1/(cm2 s)]
+
+  // statistical weight of the current event
+  G4double GetEventWeight() const { return fEventWeight; }
 
 private:
-  void DefineCommands();
+  void                  DefineCommands();
+  MAPrimarySampler&     Core();
+  void                  SampleEnergyAngle(G4double& ekin, G4double& costheta,
+                                          G4double& weight);
+  G4ThreeVector         SampleDirection(G4double costheta);
+  void                  WorldVertex(G4double& ekin, G4double& weight, G4ThreeVector& dir,
+                                    G4ThreeVector& pos);
+  void                  TankVertex(G4double& ekin, G4double& weight, G4ThreeVector& dir,
+                                   G4ThreeVector& pos);
+  void                  ComputeNormalisation();
+  void                  GenerateFromFile(G4Event* event);
+  G4ParticleDefinition* FindDefinition(G4int pdg);
+  G4bool                CavernEntry(const G4ThreeVector& point, const G4ThreeVector& dir,
+                                    G4ThreeVector& start) const;
+  void                  BuildBundleTables();
+  void                  GenerateBundle(G4Event* event, const G4ThreeVector& dir,
+                                       const G4ThreeVector& axis);
+  void                  ShootMuon(G4Event* event, G4double ekin, G4double weight,
+                                  const G4ThreeVector& dir, const G4ThreeVector& pos);
+
+  struct BundleConfig
+  {
+    G4bool   enable          = false;
+    G4double index           = 3.0;              // multiplicity power law index
+    G4int    maxMultiplicity = 20;
+    G4double r0              = 5.0 * CLHEP::m;   // separation scale
+    G4double alpha           = 3.0;              // separation power
+    G4double rmax            = 20.0 * CLHEP::m;  // largest separation
+    G4bool   operator==(const BundleConfig& rhs) const
+    {
+      return index == rhs.index && maxMultiplicity == rhs.maxMultiplicity &&
+             r0 == rhs.r0 && alpha == rhs.alpha && rmax == rhs.rmax;
+    }
+  };
 
   MADetectorConstruction* fDetector;
+  G4ParticleDefinition*   fMuonMinus   = nullptr;
+  G4ParticleDefinition*   fMuonPlus    = nullptr;
+  G4double                fChargeRatio = 1.3;  // N(mu+)/N(mu-)
+  G4double                fChargeBias  = 0.0;  // sampled mu- fraction, 0 = off
 
   G4ParticleGun*      fParticleGun;
   G4GenericMessenger* fMessenger;
-
-  std::random_device rd;
-  std::ranlux24      generator;
-  G4double           fDepth;
+  G4GenericMessenger* fBundleMessenger;
+
+  MAPhiloxEngine                    fEngine;
+  G4long                            fSeed;
+  G4double                          fDepth;
+  std::unique_ptr<MAPrimarySampler> fCore;
+
+  G4String fSamplerType  = "table";
+  G4int    fEnergyBins   = 200;
+  G4int    fCosThetaBins = 100;
+  G4bool   fSlantDepth   = true;
+  G4bool   fEnergyBias   = false;
+  G4double fBiasIndex    = 1.0;
+  G4double fEventWeight  = 1.0;
+
+  G4String fVertexMode = "world";
+  G4double fGenArea    = 0.0;
+  G4double fSolidAngle = 0.0;
+  G4double fFlux       = 0.0;
+  G4double fNormDepth  = -1.0;
+  G4String fNormMode   = "";
+
+  G4String                               fSource   = "analytic";
+  G4String                               fFileName = "primaries.bin";
+  G4int                                  fReuse    = 1;
+  std::shared_ptr<MAPrimaryFileReader>   fFile;
+  G4bool                                 fMixedWeights = false;  // warned once
+  std::map<G4int, G4ParticleDefinition*> fDefinitions;
+
+  BundleConfig    fBundle;
+  BundleConfig    fBundleBuilt{ false, -1.0 };
+  MAAliasTable    fMultiplicity;
+  MASamplingTable fSeparation;
 };
 
 #endif
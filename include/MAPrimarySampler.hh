@@ -0,0 +1,102 @@
+#ifndef MAPrimarySampler_h
+#define MAPrimarySampler_h 1
+
+// std c++ includes
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "MAMuonJointSampler.hh"
+#include "MAMuonSampler.hh"
+#include "MAPhiloxEngine.hh"
+
+/// Muon primaries in structure-of-arrays layout
+///
+/// Energy in [GeV], unit direction, vertex in [mm], statistical weight.
+
+struct MAPrimaryBatch
+{
+  std::vector<double> ekin;
+  std::vector<double> dx, dy, dz;
+  std::vector<double> x, y, z;
+  std::vector<double> weight;
+
+  void        resize(std::size_t n);
+  std::size_t size() const { return ekin.size(); }
+};
+
+/// Geant4-independent muon primary sampler
+///
+/// Energy, zenith angle, direction and the disk vertex of the world
+/// vertex mode, from a counter-based random stream, in plain doubles.
+/// The energy-angle pair comes from the shared MAMuonSampler tables or
+/// the MAMuonJointSampler alias tables.
+///
+/// With the energy bias on, energies follow E^-index over the table range
+/// instead, e.g. index 1 for uniform in log E, and the weight is the ratio
+/// of the MuEnergy table density to the biasing density. cos theta then
+/// comes from the MuAngle table; the slant depth coupling of the alias
+/// sampler is not available in this mode.
+///
+/// The scalar functions draw one primary at a time with the std:: math
+/// functions, consuming random numbers in the order the generator always
+/// did. SampleBatch() fills n primaries in one call: all uniform numbers
+/// are drawn first, then every stage is a flat loop over the batch with
+/// the MAVectorMath kernels. Both paths sample the same distributions;
+/// they consume the stream differently, so single values differ.
+///
+/// An instance holds scratch space for batches and belongs to one thread.
+
+class MAPrimarySampler
+{
+public:
+  struct Config
+  {
+    double depth        = 0.0;    // [km.w.e.]
+    bool   alias        = false;  // joint alias sampler instead of tables
+    int    energyBins   = 200;    // alias sampler grid
+    int    cosThetaBins = 100;
+    bool   slantDepth   = true;
+    bool   energyBias   = false;  // importance sampling of the energy
+    double biasIndex    = 1.0;    // biasing spectrum E^-biasIndex
+    double radius       = 0.0;    // vertex disk radius [mm]
+    double height       = 0.0;    // vertex disk z [mm]
+    bool   operator==(const Config& rhs) const
+    {
+      return depth == rhs.depth && alias == rhs.alias && energyBins == rhs.energyBins &&
+             cosThetaBins == rhs.cosThetaBins && slantDepth == rhs.slantDepth &&
+             energyBias == rhs.energyBias && biasIndex == rhs.biasIndex &&
+             radius == rhs.radius && height == rhs.height;
+    }
+  };
+
+  explicit MAPrimarySampler(const Config& cfg);
+
+  // single primary, scalar path; weight is 1 without energy bias
+  void SampleEnergyAngle(MAPhiloxEngine& engine, double& ekin, double& costheta,
+                         double& weight) const;
+  void SampleDirection(MAPhiloxEngine& engine, double costheta, double dir[3]) const;
+  void SampleDisk(MAPhiloxEngine& engine, double pos[3]) const;
+
+  // n primaries with a disk vertex, one by one or batched
+  void SampleScalar(MAPhiloxEngine& engine, MAPrimaryBatch& batch, std::size_t n) const;
+  void SampleBatch(MAPhiloxEngine& engine, MAPrimaryBatch& batch, std::size_t n);
+
+  const Config& GetConfig() const { return fConfig; }
+
+private:
+  // biased energy for u uniform in [0,1), with its weight
+  double BiasedEnergy(double u, double& weight) const;
+
+  Config                                    fConfig;
+  std::shared_ptr<const MAMuonSampler>      fTables;
+  std::shared_ptr<const MAMuonJointSampler> fJoint;
+  double                                    fBiasLow  = 0.0;  // E0^(1-index)
+  double                                    fBiasSpan = 0.0;  // E1^(1-index) - E0^(1-index)
+  double                                    fBiasNorm = 0.0;  // integral of E^-index
+  std::vector<double>                       fUniform;         // batch scratch
+  std::vector<double>                       fCos;
+  std::vector<double>                       fSin;
+};
+
+#endif
@@ -1,25 +1,53 @@
 #ifndef MARunAction_h
 #define MARunAction_h 1
 
+#include "MAConvergenceMonitor.hh"
+#include "MAIsotopeYields.hh"
+
+#include "G4GenericMessenger.hh"
 #include "G4UserRunAction.hh"
 #include "globals.hh"
 
 class G4Run;
 
+/// Output tiers
+enum class MAOutputLevel
+{
+  full,     // per-hit Score rows, ancestry as chosen, double columns
+  compact,  // aggregated hits, float columns, deduplicated ancestry
+  summary   // yield tables and per-event scalars only
+};
+
 /// Run action class
 ///
+/// Books the ntuples and owns the per-thread isotope yield accumulable;
+/// the master prints the merged yield table and saves it next to the
+/// ROOT output. The master also owns the MAConvergenceMonitor commands
+/// and /MA/output/level, with the -l option as default. Ntuples are booked
+/// at the first run, for the output level then set, and ntuples outside the
+/// tier are deactivated.
 
 class MARunAction : public G4UserRunAction
 {
 public:
-  MARunAction(G4String name);
+  MARunAction(G4String name, const G4String& level = "full");
   virtual ~MARunAction();
 
   virtual void BeginOfRunAction(const G4Run*);
   virtual void EndOfRunAction(const G4Run*);
 
+  static MAOutputLevel GetOutputLevel();
+
 private:
+  void DefineCommands();
+  void SetOutputLevel(const G4String& level);
+  void Book();
+
   G4String         fout;          // output file name
+  G4bool           fBooked = false;
+  G4GenericMessenger* fMessenger = nullptr;  // master only
+  MAIsotopeYields  fYields;
+  MAConvergenceMonitor* fMonitor = nullptr;  // master only
 };
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
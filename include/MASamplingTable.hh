@@ -0,0 +1,55 @@
+#ifndef MASamplingTable_h
+#define MASamplingTable_h 1
+
+// std c++ includes
+#include <vector>
+
+/// Tabulated inverse-CDF sampler
+///
+/// Holds the same piecewise linear density as
+/// std::piecewise_linear_distribution(nw, lower, upper, fw), i.e. nw
+/// equal intervals with the density evaluated at the nw+1 boundaries,
+/// together with its cumulative integral. The table is immutable after
+/// construction; Sample() maps one uniform number onto the support by
+/// binary search and an analytic inversion inside the interval, so it
+/// is safe to share between threads and never allocates.
+
+class MASamplingTable
+{
+public:
+  MASamplingTable() = default;
+
+  template <typename F>
+  MASamplingTable(int nw, double lower, double upper, F fw)
+  {
+    fX.reserve(nw + 1);
+    fPdf.reserve(nw + 1);
+    double delta = (upper - lower) / nw;
+    for(int k = 0; k <= nw; ++k)
+    {
+      double x = (k == nw) ? upper : lower + k * delta;
+      fX.push_back(x);
+      fPdf.push_back(fw(x));
+    }
+    BuildCDF();
+  }
+
+  // u uniform in [0,1)
+  double Sample(double u) const;
+
+  // normalised density at x, zero outside the support
+  double Density(double x) const;
+
+  double GetIntegral() const { return fCdf.empty() ? 0.0 : fCdf.back(); }
+  double GetLowerBound() const { return fX.front(); }
+  double GetUpperBound() const { return fX.back(); }
+
+private:
+  void BuildCDF();
+
+  std::vector<double> fX;    // interval boundaries
+  std::vector<double> fPdf;  // density at boundaries, unnormalised
+  std::vector<double> fCdf;  // cumulative integral at boundaries
+};
+
+#endif
@@ -1,22 +1,135 @@
 #ifndef MAStackingAction_H
 #define MAStackingAction_H 1
 
+#include <utility>
+#include <vector>
+
+#include "CLHEP/Units/SystemOfUnits.h"
+#include "G4GenericMessenger.hh"
+#include "G4ThreeVector.hh"
 #include "G4Track.hh"
 #include "G4UserStackingAction.hh"
 #include "globals.hh"
 
+class G4ParticleDefinition;
+class G4VProcess;
+
+/// Nucleus recorded at creation
+struct MAIsotope
+{
+  G4int             tid   = 0;
+  G4int             Z     = 0;
+  G4int             A     = 0;
+  G4int             vcode = -1;       // volume code at vertex
+  G4double          excitation = 0.;  // nuclear excitation energy
+  G4double          time       = 0.;
+  G4ThreeVector     vertex;
+  const G4VProcess* creator = nullptr;  // nullptr for primaries
+};
+
+/// Stacking action class
+///
+/// With /MA/stacking/isotopes true, every new nucleus (general ions and
+/// tritons, as in MALiquidSD) is recorded once, at creation, in a per-event
+/// buffer read by the event action. Recorded ions are tracked, sent to the
+/// waiting stack or killed, following /MA/stacking/ion. In record mode,
+/// nuclei created outside the sensitive volumes or at rest are killed at
+/// once, the others are stopped by MALiquidSD right after their first hit,
+/// see StopAfterHit(). Either way no decay chain is tracked, except for
+/// nuclei on the keep-list of /MA/stacking/keep, which are always tracked,
+/// whatever the ion mode and the stacking rules below.
+///
+/// Other secondaries are killed or deferred by rules added with
+/// /MA/stacking/rule, matching particle, creation volume code, kinetic
+/// energy below a limit and distance to the cryostat above a limit. The
+/// first matching rule applies. Rules are compiled before the next event
+/// into a flat table by particle definition ID and volume code, each cell
+/// holding its candidate rules. Kills and deferrals are counted per rule;
+/// EndOfRun() is called by the run action, the master prints the totals.
+///
+/// With /MA/stacking/staged true, electrons, positrons and gammas below
+/// /MA/stacking/emThreshold wait while hadrons, ions and everything else
+/// are tracked first. When only the waiting stack is left, NewStage()
+/// keeps the deferred EM showers if the event already has hits or nuclei
+/// created in the sensitive volumes, and drops them otherwise. Only the
+/// deferred EM tracks are dropped: ions waiting under /MA/stacking/ion wait
+/// and tracks deferred by a wait rule share the stage and are tracked.
+
 class MAStackingAction : public G4UserStackingAction
 {
 public:
-  MAStackingAction()          = default;
-  virtual ~MAStackingAction() = default;
+  MAStackingAction();
+  virtual ~MAStackingAction();
 
 public:
   virtual G4ClassificationOfNewTrack ClassifyNewTrack(const G4Track* aTrack);
   virtual void                       NewStage();
   virtual void                       PrepareNewEvent();
 
+  const std::vector<MAIsotope>& GetIsotopes() const { return fIsotopes; }
+
+  // true if this nucleus is to be stopped after its hit, in record mode
+  static G4bool StopAfterHit(const G4Track* aTrack);
+
+  // fold this thread's rule counts; the master prints and resets them
+  static void EndOfRun(G4bool master);
+
 private:
+  struct Rule
+  {
+    G4String                    text;      // as given, for the summary
+    G4String                    particle;  // or "all"
+    G4int                       vcode = -2;  // -2 for all volumes
+    G4ClassificationOfNewTrack  action = fKill;
+    G4double                    emax   = 0.;  // applies below
+    G4double                    dmin   = 0.;  // applies beyond
+    const G4ParticleDefinition* def    = nullptr;  // compiled, nullptr for all
+  };
+
+  struct Cell
+  {
+    G4int begin = 0;  // range in fCellRules
+    G4int end   = 0;
+  };
+
+  void DefineCommands();
+  void AddRule(const G4String& rule);
+  void ClearRules();
+  void CompileRules();
+  void AddKeep(const G4String& isotope);
+  void ClearKeep();
+  G4bool IsKept(G4int Z, G4int A) const;
+  G4ClassificationOfNewTrack ApplyRules(const G4Track* aTrack);
+  G4int  MatchRule(const G4Track* aTrack) const;  // rule index, or -1
+  G4bool IsStagedEM(const G4Track* aTrack) const;
+
+  G4GenericMessenger*    fMessenger = nullptr;
+  G4bool                 fRecord    = false;
+  G4String               fIonMode   = "track";  // or "wait", "kill", "record"
+  std::vector<MAIsotope> fIsotopes;
+  std::vector<std::pair<G4int, G4int>> fKeep;  // Z, A always tracked
+  G4double               fIonsKilled  = 0.;     // at creation
+  G4double               fIonsStopped = 0.;     // after their hit
+  G4double               fIonsKept    = 0.;
+
+  // track-kill policy
+  std::vector<Rule>     fRules;
+  G4bool                fDirty = false;  // rules changed since compiling
+  G4int                 fRows  = 0;      // particle IDs + 1 for the rest
+  std::vector<Cell>     fCells;          // by row and volume code + 1
+  std::vector<G4int>    fCellRules;      // rule indices, in rule order
+  // staged tracking
+  G4bool                fStaged      = false;
+  G4double              fEMThreshold = 100. * CLHEP::MeV;
+  G4int                 fStage       = 0;
+  G4bool                fDropping    = false;  // in NewStage() reclassification
+  G4double              fKept        = 0.;  // events with waiting EM kept
+  G4double              fDropped     = 0.;  // and dropped
+
+  G4ThreeVector         fTankCentre;
+  G4double              fTankHalfSide = 0.;
+  std::vector<G4double> fCounts;  // tracks per rule
+  std::vector<G4double> fEnergy;  // their kinetic energy
 };
 
 #endif
@@ -0,0 +1,44 @@
+#ifndef MASteppingAction_h
+#define MASteppingAction_h 1
+
+// std c++ includes
+#include <vector>
+
+#include "G4UserSteppingAction.hh"
+#include "globals.hh"
+
+#include "MAPrimaryFile.hh"
+
+class G4VPhysicalVolume;
+
+/// Stepping action for stage-1 phase-space recording
+///
+/// Every particle stepping from Cavern_phys into Hall_phys is written to
+/// a binary primary file at the boundary and then killed, so no time is
+/// spent inside the hall. Stage 2 replays the file with
+/// /MA/generator/source file.
+///
+/// Records are collected per thread and appended to the shared file in
+/// whole events, so each stage-1 event with a crossing becomes one
+/// numbered event of the file. EndOfRun() is called by the run action.
+
+class MASteppingAction : public G4UserSteppingAction
+{
+public:
+  MASteppingAction(const G4String& filename);
+  virtual ~MASteppingAction();
+
+  virtual void UserSteppingAction(const G4Step*);
+
+  // flush this thread's records; the master also updates the file header
+  static void EndOfRun(G4bool master);
+
+private:
+  void Flush();
+
+  G4VPhysicalVolume*           fCavern = nullptr;
+  G4VPhysicalVolume*           fHall   = nullptr;
+  std::vector<MAPrimaryRecord> fBuffer;
+};
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef MATrackHistory_h
+#define MATrackHistory_h 1
+
+// std c++ includes
+#include <cstddef>
+#include <vector>
+
+#include "G4ThreeVector.hh"
+#include "globals.hh"
+
+class G4Track;
+
+/// Per-thread track history table
+///
+/// One row per track of the event in structure-of-arrays layout, with
+/// exactly what the ancestry output needs: track and parent ID, PDG code,
+/// vertex position and vertex volume code. Filled once per track from
+/// the tracking action, with no per-step work or per-track allocation;
+/// a light replacement for storing full MATrajectory objects. Rows are
+/// kept between events and only cleared, so capacity is reused.
+
+class MATrackHistory
+{
+public:
+  MATrackHistory() = default;
+
+  void Clear();
+  void Record(const G4Track* track);
+  void Add(G4int tid, G4int pid, G4int pdg, G4int vcode, const G4ThreeVector& vertex);
+
+  void   SetEnabled(G4bool val) { fEnabled = val; }
+  G4bool IsEnabled() const { return fEnabled; }
+
+  std::size_t size() const { return fTrackID.size(); }
+
+  const std::vector<G4int>&    GetTrackID() const { return fTrackID; }
+  const std::vector<G4int>&    GetParentID() const { return fParentID; }
+  const std::vector<G4int>&    GetPDG() const { return fPDG; }
+  const std::vector<G4int>&    GetVertexCode() const { return fVertexCode; }
+  const std::vector<G4double>& GetX() const { return fX; }
+  const std::vector<G4double>& GetY() const { return fY; }
+  const std::vector<G4double>& GetZ() const { return fZ; }
+
+private:
+  G4bool                fEnabled = false;
+  std::vector<G4int>    fTrackID;
+  std::vector<G4int>    fParentID;
+  std::vector<G4int>    fPDG;
+  std::vector<G4int>    fVertexCode;
+  std::vector<G4double> fX, fY, fZ;  // vertex position [mm]
+};
+
+#endif
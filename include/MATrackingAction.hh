@@ -3,14 +3,24 @@
 
 #include "G4UserTrackingAction.hh"
 
+class MATrackHistory;
+
+/// Tracking action class
+///
+/// Records each track in the MATrackHistory of the thread when enabled,
+/// and creates MATrajectory objects if trajectory storage is requested.
+
 class MATrackingAction : public G4UserTrackingAction
 {
 public:
-  MATrackingAction();
+  MATrackingAction(MATrackHistory* history);
   virtual ~MATrackingAction(){};
 
   virtual void PreUserTrackingAction(const G4Track*);
   virtual void PostUserTrackingAction(const G4Track*);
+
+private:
+  MATrackHistory* fHistory;  // owned by the event action
 };
 
 #endif
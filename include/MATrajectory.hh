@@ -40,7 +40,7 @@ public:
   virtual G4int               GetTrackID() const { return fTrackID; }
   virtual G4int               GetParentID() const { return fParentID; }
   virtual G4String            GetParticleName() const { return fParticleName; }
-  virtual G4String            GetVertexName() const { return fVertexName; }
+  virtual G4int               GetVertexCode() const { return fVertexCode; }
   virtual G4int               GetPDGEncoding() const { return fPDGEncoding; }
   virtual G4ThreeVector       GetVertex() const { return fVertexPosition; }
   virtual int                 GetPointEntries() const { return fPositionRecord->size(); }
@@ -54,7 +54,7 @@ private:
   G4int                         fParentID;
   G4ParticleDefinition*         fParticleDefinition;
   G4String                      fParticleName;
-  G4String                      fVertexName;
+  G4int                         fVertexCode;  // volume code, MAVolumeCodes
   G4int                         fPDGEncoding;
   G4ThreeVector                 fVertexPosition;
 };
@@ -0,0 +1,47 @@
+#ifndef MAVolumeCodes_h
+#define MAVolumeCodes_h 1
+
+// std c++ includes
+#include <array>
+#include <atomic>
+#include <vector>
+
+#include "G4LogicalVolume.hh"
+#include "globals.hh"
+
+/// Integer volume codes
+///
+/// The code of each logical volume (see README) is attached once during
+/// geometry construction and looked up by logical volume instance ID in
+/// constant time, so hits and trajectories store it without any string
+/// handling. Filled on the master before workers start, read-only after.
+/// Volumes without a code, e.g. the world, give -1. Codes of volumes read
+/// out by MALiquidSD are flagged with SetSensitive() where the detector is
+/// attached; every thread does so, hence the atomic flags.
+
+class MAVolumeCodes
+{
+public:
+  static constexpr G4int kNumCodes = 12;  // codes 0 to 11
+
+  // liquid argon volumes read out by MALiquidSD
+  static G4bool IsSensitive(G4int code)
+  {
+    return code >= 0 && code < kNumCodes && fSensitive[code].load(std::memory_order_relaxed);
+  }
+
+  static void Set(const G4LogicalVolume* lv, G4int code);
+  static void SetSensitive(const G4LogicalVolume* lv);
+
+  static G4int Get(const G4LogicalVolume* lv)
+  {
+    auto id = static_cast<std::size_t>(lv->GetInstanceID());
+    return (id < fCodes.size()) ? fCodes[id] : -1;
+  }
+
+private:
+  static std::vector<G4int> fCodes;  // by logical volume instance ID
+  static std::array<std::atomic<G4bool>, kNumCodes> fSensitive;  // by code
+};
+
+#endif
@@ -0,0 +1,108 @@
+// ********************************************************************
+// muonargon project
+//
+// Throughput of the Geant4-independent primary sampling: muons with
+// energy, direction and disk vertex per second, for the scalar path,
+// one primary per call as in the generator, and the batched path.
+// Sample means are printed as a consistency check between the two.
+
+// standard
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+// us
+#include "CLI11.hpp"  // c++17 safe; https://github.com/CLIUtils/CLI11
+#include "MAPhiloxEngine.hh"
+#include "MAPrimarySampler.hh"
+
+namespace
+{
+  struct Summary
+  {
+    double rate     = 0.0;  // primaries per second
+    double meanE    = 0.0;  // [GeV]
+    double meanCos  = 0.0;
+    double meanR2   = 0.0;  // [m2]
+    double checksum = 0.0;  // keeps the work from being optimised away
+  };
+
+  template <typename F>
+  Summary Run(F fill, MAPrimaryBatch& batch, long total, std::size_t chunk)
+  {
+    Summary s;
+    auto    start = std::chrono::steady_clock::now();
+    for(long done = 0; done < total; done += chunk)
+    {
+      fill(batch, chunk);
+      for(std::size_t i = 0; i < chunk; ++i)
+      {
+        s.meanE += batch.ekin[i];
+        s.meanCos -= batch.dz[i];
+        s.meanR2 += (batch.x[i] * batch.x[i] + batch.y[i] * batch.y[i]) * 1.0e-6;
+        s.checksum += batch.dx[i] + batch.dy[i];
+      }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    double n = double((total + chunk - 1) / chunk * chunk);
+    s.rate   = n / elapsed.count();
+    s.meanE /= n;
+    s.meanCos /= n;
+    s.meanR2 /= n;
+    return s;
+  }
+
+  void Print(const char* name, const Summary& s)
+  {
+    std::printf("%-8s %12.4g primaries/s   <E> %8.3f GeV   <cos> %.5f   <r2> %8.3f m2"
+                "   (checksum %g)\n",
+                name, s.rate, s.meanE, s.meanCos, s.meanR2, s.checksum);
+  }
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  // command line interface
+  CLI::App    app{ "Muon on Argon primary sampling benchmark" };
+  long        total = 10000000;
+  std::size_t chunk = 4096;
+  double      depth = 3.4;
+  bool        alias = false;
+  long        seed  = 1234567;
+
+  app.add_option("-n,--primaries", total, "<number of primaries per path> Default: 1e7");
+  app.add_option("-b,--batch", chunk, "<batch size> Default: 4096")
+    ->check(CLI::PositiveNumber);
+  app.add_option("-d,--depth", depth, "<laboratory depth [km.w.e.]> Default: 3.4");
+  app.add_flag("-a,--alias", alias, "<use the joint alias sampler> Default: tables");
+  app.add_option("-s,--seed", seed, "<random seed> Default: 1234567");
+
+  CLI11_PARSE(app, argc, argv);
+
+  MAPrimarySampler::Config cfg;
+  cfg.depth  = depth;
+  cfg.alias  = alias;
+  cfg.radius = 10.0e3;  // vertex disk [mm], only enters <r2>
+  cfg.height = 10.0e3;
+  MAPrimarySampler sampler(cfg);  // tables built here, outside the timing
+  MAPrimaryBatch   batch;
+
+  std::printf("%ld primaries, batch size %zu, depth %g km.w.e., %s sampler\n", total, chunk,
+              depth, alias ? "alias" : "table");
+
+  MAPhiloxEngine scalarEngine(seed, 0);
+  Summary        scalar = Run(
+    [&](MAPrimaryBatch& b, std::size_t n) { sampler.SampleScalar(scalarEngine, b, n); },
+    batch, total, chunk);
+  Print("scalar", scalar);
+
+  MAPhiloxEngine batchEngine(seed, 1);
+  Summary        batched = Run(
+    [&](MAPrimaryBatch& b, std::size_t n) { sampler.SampleBatch(batchEngine, b, n); },
+    batch, total, chunk);
+  Print("batched", batched);
+
+  std::printf("speed-up %.2f\n", batched.rate / scalar.rate);
+  return 0;
+}
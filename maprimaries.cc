@@ -0,0 +1,151 @@
+// ********************************************************************
+// muonargon project
+//
+// Convert an ASCII list of primaries into the binary file read by
+// /MA/generator/source file. One particle per line,
+//   pdg  E  x  y  z  dx  dy  dz  [time  [weight]]
+// with energy and length units set on the command line, time in ns.
+// Each line is one event unless --grouped is given; then a leading
+// event number column joins consecutive lines into one event, whose
+// lines must all carry the same weight.
+// Lines starting with '#' are skipped.
+
+// standard
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// us
+#include "CLI11.hpp"  // c++17 safe; https://github.com/CLIUtils/CLI11
+#include "MAPrimaryFile.hh"
+
+int main(int argc, char** argv)
+{
+  // command line interface
+  CLI::App    app{ "Muon on Argon primary file converter" };
+  std::string inputFileName;
+  std::string outputFileName("primaries.bin");
+  std::string energyUnit("GeV");
+  std::string lengthUnit("cm");
+  bool        grouped = false;
+
+  app.add_option("-i,--inputFile", inputFileName, "<ASCII primary list>")->required();
+  app.add_option("-o,--outputFile", outputFileName,
+                 "<binary primary file> Default: primaries.bin");
+  app.add_option("-e,--energyUnit", energyUnit, "<MeV|GeV|TeV> Default: GeV")
+    ->check(CLI::IsMember({ "MeV", "GeV", "TeV" }));
+  app.add_option("-l,--lengthUnit", lengthUnit, "<mm|cm|m> Default: cm")
+    ->check(CLI::IsMember({ "mm", "cm", "m" }));
+  app.add_flag("-g,--grouped", grouped, "<first column is an event number> Default: off");
+
+  CLI11_PARSE(app, argc, argv);
+
+  // to Geant4 internal units, MeV and mm
+  double escale = (energyUnit == "MeV") ? 1.0 : (energyUnit == "GeV") ? 1.0e3 : 1.0e6;
+  double lscale = (lengthUnit == "mm") ? 1.0 : (lengthUnit == "cm") ? 10.0 : 1.0e3;
+
+  std::ifstream input(inputFileName);
+  if(!input)
+  {
+    std::cerr << "Cannot open " << inputFileName << std::endl;
+    return 1;
+  }
+  MAPrimaryFileWriter writer;
+  if(!writer.Open(outputFileName))
+  {
+    std::cerr << "Cannot create " << outputFileName << std::endl;
+    return 1;
+  }
+
+  // buffered conversion, constant memory
+  const std::size_t            chunk = 65536;
+  std::vector<MAPrimaryRecord> buffer;
+  buffer.reserve(chunk);
+
+  std::string   line;
+  long          lineno = 0;
+  long          label  = 0;  // event number column of the previous line
+  std::uint32_t event  = 0;
+  double        weight = 1.0;  // of the current event
+  bool          mixed  = false;
+  while(std::getline(input, line))
+  {
+    ++lineno;
+    if(line.empty() || line[0] == '#')
+      continue;
+
+    std::istringstream ss(line);
+    long               evt = 0;
+    int                pdg;
+    double             e, x, y, z, dx, dy, dz;
+    double             t = 0.0, w = 1.0;
+    if((grouped && !(ss >> evt)) || !(ss >> pdg >> e >> x >> y >> z >> dx >> dy >> dz))
+    {
+      std::cerr << "Skipping malformed line " << lineno << std::endl;
+      continue;
+    }
+    double extra;  // optional columns
+    if(ss >> extra)
+    {
+      t = extra;
+      if(ss >> extra)
+        w = extra;
+    }
+
+    double norm = std::sqrt(dx * dx + dy * dy + dz * dz);
+    if(norm <= 0.0)
+    {
+      std::cerr << "Skipping line " << lineno << " without direction" << std::endl;
+      continue;
+    }
+    // new event on every line, or on a change of event number
+    bool first = (writer.GetEntries() + buffer.size() == 0);
+    if(!first && (!grouped || evt != label))
+      ++event;
+    else if(!first && w != weight)
+    {
+      // one event, one weight: the generator weights the whole event
+      std::cerr << "Line " << lineno << ": weight " << w << " differs from "
+                << weight << " of event " << evt << ", conversion failed" << std::endl;
+      mixed = true;
+      break;
+    }
+    label  = evt;
+    weight = w;
+
+    buffer.push_back({ pdg, float(e * escale), float(x * lscale), float(y * lscale),
+                       float(z * lscale), float(dx / norm), float(dy / norm),
+                       float(dz / norm), float(t), float(w), event });
+
+    if(buffer.size() == chunk)
+    {
+      if(!writer.Write(buffer.data(), buffer.size()))
+        break;
+      buffer.clear();
+    }
+  }
+  bool good = !mixed && writer.Write(buffer.data(), buffer.size());
+  good      = writer.Close() && good;
+  if(!good)
+  {
+    // never leave a file whose header may promise missing records
+    if(!mixed)
+      std::cerr << "Error writing " << outputFileName << ": " << std::strerror(errno)
+                << ", conversion failed" << std::endl;
+    std::error_code ec;
+    if(std::filesystem::is_regular_file(outputFileName, ec))
+      std::remove(outputFileName.c_str());
+    return 1;
+  }
+
+  std::cout << "Wrote " << writer.GetEntries() << " primaries to " << outputFileName
+            << std::endl;
+  return 0;
+}
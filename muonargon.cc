@@ -14,8 +14,11 @@
 #  include "G4RunManager.hh"
 #endif
 
+#include "G4FastSimulationPhysics.hh"
 #include "G4NeutronTrackingCut.hh"
+#include "G4StepLimiterPhysics.hh"
 #include "G4Threading.hh"
+#include "Randomize.hh"
 #include "G4UImanager.hh"
 // #include "FTFP_BERT_HP.hh"
 #include "Shielding.hh"
@@ -30,13 +33,25 @@ int main(int argc, char** argv)
   // command line interface
   CLI::App    app{ "Muon on Argon Simulation" };
   int         nthreads = 4;
+  long        seed     = 1234567;
   std::string outputFileName("ma.root");
   std::string macroName;
+  std::string phaseSpaceFileName;
+  std::string outputLevel("full");
+  bool        fastShower = false;
 
   app.add_option("-m,--macro", macroName, "<Geant4 macro filename> Default: None");
   app.add_option("-o,--outputFile", outputFileName,
                  "<FULL PATH ROOT FILENAME> Default: ma.root");
   app.add_option("-t, --nthreads", nthreads, "<number of threads to use> Default: 4");
+  app.add_option("-s,--seed", seed, "<master random seed> Default: 1234567");
+  app.add_option("-p,--phaseSpaceFile", phaseSpaceFileName,
+                 "<stage 1: record and stop particles entering the hall> Default: None");
+  app.add_option("-l,--outputLevel", outputLevel,
+                 "<output tier: full, compact or summary> Default: full")
+    ->check(CLI::IsMember({ "full", "compact", "summary" }));
+  app.add_flag("-f,--fastShower", fastShower,
+               "<parameterised EM showers in the cavern rock> Default: off");
 
   CLI11_PARSE(app, argc, argv);
 
@@ -48,6 +63,9 @@ int main(int argc, char** argv)
     return 1;
   }
 
+  // -- Master seed for Geant4 engine; per-event seeds derive from it
+  G4Random::setTheSeed(seed);
+
   // -- Construct the run manager : MT or sequential one
 #ifdef G4MULTITHREADED
   nthreads =
@@ -78,12 +96,27 @@ int main(int argc, char** argv)
   auto* neutronCut  = new G4NeutronTrackingCut(1);
   neutronCut->SetTimeLimit(2.0 * CLHEP::ms);  // 2 milli sec limit
   physicsList->RegisterPhysics(neutronCut);
+  // user limits of the detector regions, see /MA/detector/region/
+  physicsList->RegisterPhysics(new G4StepLimiterPhysics);
+
+  // fast simulation of rock EM showers
+  if(fastShower)
+  {
+    auto* fastSim = new G4FastSimulationPhysics;
+    fastSim->ActivateFastSimulation("e-");
+    fastSim->ActivateFastSimulation("e+");
+    fastSim->ActivateFastSimulation("gamma");
+    physicsList->RegisterPhysics(fastSim);
+    detector->SetFastShower(true);
+  }
 
   // finish physics list
   runManager->SetUserInitialization(physicsList);
 
   // -- Set user action initialization class, forward random seed
-  auto* actions = new MAActionInitialization(detector, outputFileName);
+  auto* actions =
+    new MAActionInitialization(detector, outputFileName, seed, phaseSpaceFileName,
+                               outputLevel);
   runManager->SetUserInitialization(actions);
 
   // Get the pointer to the User Interface manager
@@ -3,28 +3,42 @@
 #include "MAPrimaryGeneratorAction.hh"
 #include "MARunAction.hh"
 #include "MAStackingAction.hh"
+#include "MASteppingAction.hh"
+#include "MATrackHistory.hh"
 #include "MATrackingAction.hh"
 
 MAActionInitialization::MAActionInitialization(MADetectorConstruction* det,
-                                                   G4String                  name)
+                                                   G4String                  name,
+                                                   G4long                    seed,
+                                                   G4String phasespace,
+                                                   G4String level)
 : G4VUserActionInitialization()
 , fDet(det)
 , foutname(std::move(name))
+, fseed(seed)
+, fphasespace(std::move(phasespace))
+, flevel(std::move(level))
 {}
 
 MAActionInitialization::~MAActionInitialization() = default;
 
 void MAActionInitialization::BuildForMaster() const
 {
-  SetUserAction(new MARunAction(foutname));
+  SetUserAction(new MARunAction(foutname, flevel));
 }
 
 void MAActionInitialization::Build() const
 {
-  // forward detector
-  SetUserAction(new MAPrimaryGeneratorAction(fDet));
-  SetUserAction(new MAEventAction);
-  SetUserAction(new MARunAction(foutname));
+  // forward detector and master seed
+  SetUserAction(new MAPrimaryGeneratorAction(fDet, fseed));
+  // track histories shared by tracking and event action of this thread
+  auto* history = new MATrackHistory;
+  SetUserAction(new MAEventAction(history));
+  SetUserAction(new MARunAction(foutname, flevel));
   SetUserAction(new MAStackingAction);
-  SetUserAction(new MATrackingAction);
+  SetUserAction(new MATrackingAction(history));
+
+  // stage 1 of a two-stage simulation
+  if(!fphasespace.empty())
+    SetUserAction(new MASteppingAction(fphasespace));
 }
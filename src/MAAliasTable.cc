@@ -0,0 +1,40 @@
+#include "MAAliasTable.hh"
+
+#include <numeric>
+
+MAAliasTable::MAAliasTable(const std::vector<double>& weights)
+: fProb(weights.size(), 1.0)
+, fAlias(weights.size())
+{
+  std::size_t n     = weights.size();
+  double      total = std::accumulate(weights.begin(), weights.end(), 0.0);
+
+  // scaled weights, mean one
+  std::vector<double> scaled(n);
+  std::vector<int>    small, large;
+  for(std::size_t i = 0; i < n; ++i)
+  {
+    fAlias[i] = static_cast<int>(i);
+    scaled[i] = (total > 0.0) ? weights[i] * n / total : 1.0;
+    (scaled[i] < 1.0) ? small.push_back(i) : large.push_back(i);
+  }
+
+  // pair each under-full bin with an over-full one
+  while(!small.empty() && !large.empty())
+  {
+    int s = small.back();
+    small.pop_back();
+    int l = large.back();
+    large.pop_back();
+
+    fProb[s]  = scaled[s];
+    fAlias[s] = l;
+    scaled[l] = (scaled[l] + scaled[s]) - 1.0;
+    (scaled[l] < 1.0) ? small.push_back(l) : large.push_back(l);
+  }
+  // left-overs are full up to rounding
+  for(int i : large)
+    fProb[i] = 1.0;
+  for(int i : small)
+    fProb[i] = 1.0;
+}
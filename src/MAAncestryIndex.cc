@@ -0,0 +1,58 @@
+#include "MAAncestryIndex.hh"
+
+#include <algorithm>
+
+void MAAncestryIndex::Build(const std::vector<int>& tid, const std::vector<int>& pid)
+{
+  // track ids are small positive integers, a dense table is enough
+  int maxid = 0;
+  for(int id : tid)
+    maxid = std::max(maxid, id);
+  fPosition.assign(maxid + 1, -1);
+  for(std::size_t i = 0; i < tid.size(); ++i)
+    fPosition[tid[i]] = static_cast<int>(i);
+
+  fParent.resize(tid.size());
+  for(std::size_t i = 0; i < pid.size(); ++i)
+    fParent[i] = Position(pid[i]);
+
+  fChainOf.assign(tid.size(), -1);
+  fOffset.assign(tid.size(), 0);
+  fChains.clear();
+  fSteps = 0;
+}
+
+const std::vector<int>& MAAncestryIndex::Chain(int tid)
+{
+  static const std::vector<int> none;
+  int idx = Position(tid);
+  if(idx < 0)
+    return none;
+  if(fChainOf[idx] >= 0 && fOffset[idx] == 0)
+    return fChains[fChainOf[idx]];
+
+  // new links up to the first labelled ancestor, then its known rest
+  std::vector<int> result;
+  int              link = idx;
+  for(; link >= 0 && fChainOf[link] < 0; link = fParent[link])
+  {
+    result.push_back(link);
+    ++fSteps;
+  }
+  std::size_t walked = result.size();
+  if(link >= 0)
+  {
+    const auto& known = fChains[fChainOf[link]];
+    result.insert(result.end(), known.begin() + fOffset[link], known.end());
+  }
+
+  // label the walked links, and the track itself if it was inside a chain
+  int chain = static_cast<int>(fChains.size());
+  for(std::size_t k = 0; k < std::max<std::size_t>(walked, 1); ++k)
+  {
+    fChainOf[result[k]] = chain;
+    fOffset[result[k]]  = static_cast<int>(k);
+  }
+  fChains.push_back(std::move(result));
+  return fChains.back();
+}
@@ -0,0 +1,214 @@
+#include "MAConvergenceMonitor.hh"
+#include "MAStackingAction.hh"
+
+#include "G4AutoLock.hh"
+#include "G4ios.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <sstream>
+
+namespace
+{
+  struct Target
+  {
+    G4int Z, A, vcode;
+  };
+
+  // settings, written by the master between runs
+  std::vector<Target> targets;
+  G4double            precision = 0.;
+  G4int               interval  = 1000;
+  G4int               minEvents = 100;  // before testing the precision
+  G4int               minHits   = 10;   // events with a target, each
+
+  // shared totals
+  G4Mutex               monitorMutex = G4MUTEX_INITIALIZER;
+  std::vector<G4double> sum, sum2, hits;
+  G4double              events = 0.;
+  std::atomic<bool>     converged{ false };
+
+  // per-thread totals since the last fold
+  struct Tally
+  {
+    std::vector<G4double> sum, sum2, hits;
+    G4int                 events = 0;
+  };
+  G4ThreadLocal Tally* threadTally = nullptr;
+
+  G4double RelativeError(std::size_t i)
+  {
+    if(sum[i] <= 0. || events < 2.)
+      return 1.;
+    // unbiased variance of the per-event counts, times N for the sum
+    G4double var = std::max(sum2[i] - sum[i] * sum[i] / events, 0.) * events / (events - 1.);
+    return std::sqrt(var) / sum[i];
+  }
+
+  G4bool Converged(std::size_t i)
+  {
+    return events >= minEvents && hits[i] >= minHits && RelativeError(i) < precision;
+  }
+
+  // fold a thread's tally into the totals and test convergence
+  void Fold(Tally& t)
+  {
+    G4AutoLock lock(&monitorMutex);
+    for(std::size_t i = 0; i < targets.size(); ++i)
+    {
+      sum[i] += t.sum[i];
+      sum2[i] += t.sum2[i];
+      hits[i] += t.hits[i];
+    }
+    events += t.events;
+    std::fill(t.sum.begin(), t.sum.end(), 0.);
+    std::fill(t.sum2.begin(), t.sum2.end(), 0.);
+    std::fill(t.hits.begin(), t.hits.end(), 0.);
+    t.events = 0;
+
+    G4bool done = !targets.empty();
+    for(std::size_t i = 0; i < targets.size() && done; ++i)
+      done = Converged(i);
+    if(done)
+      converged = true;
+  }
+}
+
+MAConvergenceMonitor::MAConvergenceMonitor() { DefineCommands(); }
+
+MAConvergenceMonitor::~MAConvergenceMonitor() { delete fMessenger; }
+
+void MAConvergenceMonitor::BeginOfRun()
+{
+  G4AutoLock lock(&monitorMutex);
+  sum.assign(targets.size(), 0.);
+  sum2.assign(targets.size(), 0.);
+  hits.assign(targets.size(), 0.);
+  events    = 0.;
+  converged = false;
+}
+
+G4bool MAConvergenceMonitor::AddEvent(const std::vector<MAIsotope>& isotopes,
+                                      G4double                      weight)
+{
+  if(!IsActive())
+    return false;
+
+  if(threadTally == nullptr)
+    threadTally = new Tally;
+  Tally& t = *threadTally;
+  t.sum.resize(targets.size(), 0.);
+  t.sum2.resize(targets.size(), 0.);
+  t.hits.resize(targets.size(), 0.);
+
+  for(std::size_t i = 0; i < targets.size(); ++i)
+  {
+    G4int n = 0;
+    for(const auto& iso : isotopes)
+    {
+      if(iso.Z == targets[i].Z && iso.A == targets[i].A && iso.vcode == targets[i].vcode)
+        ++n;
+    }
+    t.sum[i] += weight * n;
+    t.sum2[i] += weight * n * weight * n;
+    if(n > 0)
+      t.hits[i] += 1.;
+  }
+
+  if(++t.events >= interval)
+    Fold(t);
+  return converged;
+}
+
+void MAConvergenceMonitor::EndOfRun(G4bool master)
+{
+  if(!IsActive())
+    return;
+
+  // remainder of a worker, or of the only thread in sequential mode
+  if(threadTally != nullptr)
+  {
+    Fold(*threadTally);
+    delete threadTally;
+    threadTally = nullptr;
+  }
+  if(!master)
+    return;
+
+  G4AutoLock lock(&monitorMutex);
+  G4cout << "--- Convergence: " << events << " events, "
+         << (converged ? "target precision reached" : "target precision not reached")
+         << G4endl;
+  for(std::size_t i = 0; i < targets.size(); ++i)
+  {
+    G4cout << "    Z " << targets[i].Z << " A " << targets[i].A << " VCode "
+           << targets[i].vcode << ": " << sum[i] << " weighted in " << hits[i]
+           << " events, relative error "
+           << RelativeError(i) << G4endl;
+  }
+}
+
+G4bool MAConvergenceMonitor::IsActive() { return precision > 0. && !targets.empty(); }
+
+void MAConvergenceMonitor::AddTarget(const G4String& target)
+{
+  std::istringstream is(target);
+  Target             t;
+  if(!(is >> t.Z >> t.A >> t.vcode) || t.Z < 0 || t.A < t.Z)
+  {
+    G4ExceptionDescription msg;
+    msg << "Bad target '" << target << "', expect Z A VCode";
+    G4Exception("MAConvergenceMonitor::AddTarget()", "MyCode0007", JustWarning, msg);
+    return;
+  }
+  targets.push_back(t);
+}
+
+void MAConvergenceMonitor::ClearTargets() { targets.clear(); }
+
+void MAConvergenceMonitor::DefineCommands()
+{
+  fMessenger = new G4GenericMessenger(this, "/MA/run/", "Run termination control");
+
+  fMessenger->DeclareProperty("targetPrecision", precision)
+    .SetGuidance("Stop the run once all target isotopes have reached this")
+    .SetGuidance("relative statistical error; 0 runs all events.")
+    .SetGuidance("Needs /MA/stacking/isotopes true.")
+    .SetParameterName("p", false)
+    .SetRange("p>=0.")
+    .SetStates(G4State_PreInit, G4State_Idle)
+    .SetToBeBroadcasted(false);
+
+  fMessenger->DeclareMethod("target", &MAConvergenceMonitor::AddTarget)
+    .SetGuidance("Add a target isotope for the run termination: Z A VCode")
+    .SetParameterName("isotope", false)
+    .SetStates(G4State_PreInit, G4State_Idle)
+    .SetToBeBroadcasted(false);
+
+  fMessenger->DeclareMethod("clearTargets", &MAConvergenceMonitor::ClearTargets)
+    .SetGuidance("Remove all target isotopes.")
+    .SetStates(G4State_PreInit, G4State_Idle)
+    .SetToBeBroadcasted(false);
+
+  fMessenger->DeclareProperty("checkInterval", interval)
+    .SetGuidance("Events per worker between convergence checks.")
+    .SetParameterName("n", false)
+    .SetRange("n>0")
+    .SetStates(G4State_PreInit, G4State_Idle)
+    .SetToBeBroadcasted(false);
+
+  fMessenger->DeclareProperty("minEvents", minEvents)
+    .SetGuidance("Events before the target precision is tested.")
+    .SetParameterName("n", false)
+    .SetRange("n>=2")
+    .SetStates(G4State_PreInit, G4State_Idle)
+    .SetToBeBroadcasted(false);
+
+  fMessenger->DeclareProperty("minTargetEvents", minHits)
+    .SetGuidance("Events with each target isotope before its precision is tested.")
+    .SetParameterName("n", false)
+    .SetRange("n>=1")
+    .SetStates(G4State_PreInit, G4State_Idle)
+    .SetToBeBroadcasted(false);
+}
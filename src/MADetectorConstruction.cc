@@ -1,11 +1,14 @@
 #include "MADetectorConstruction.hh"
 
 #include <cmath>
+#include <memory>
+#include <sstream>
 
 #include "G4Box.hh"
 #include "G4Tubs.hh"
 #include "G4Polyhedra.hh"
 #include "G4LogicalVolume.hh"
+#include "G4LogicalVolumeStore.hh"
 #include "G4Material.hh"
 #include "G4NistManager.hh"
 #include "G4PVPlacement.hh"
@@ -15,21 +18,41 @@
 #include "G4Colour.hh"
 #include "G4VisAttributes.hh"
 
+#include "G4ProductionCuts.hh"
+#include "G4Region.hh"
+#include "G4RegionStore.hh"
 #include "G4SDManager.hh"
+#include "G4UIcommand.hh"
+#include "G4UnitsTable.hh"
+#include "G4UserLimits.hh"
+#include "MAEMShowerModel.hh"
 #include "MALiquidSD.hh"
+#include "MAVolumeCodes.hh"
 
 #include "G4PhysicalConstants.hh"
 #include "G4SystemOfUnits.hh"
 
+namespace
+{
+  // fast shower model of this thread, deleted when the thread ends
+  G4ThreadLocal std::unique_ptr<MAEMShowerModel> showerModel;
+}
+
 MADetectorConstruction::MADetectorConstruction()
 {
   DefineCommand();
   DefineMaterials();
+  DefineRegions();
 }
 
 MADetectorConstruction::~MADetectorConstruction()
 {
   delete fDetectorMessenger;
+  delete fRegionMessenger;
+  for(auto& setting : fRegions)
+  {
+    delete setting.limits;
+  }
 }
 
 auto MADetectorConstruction::Construct() -> G4VPhysicalVolume*
@@ -99,15 +122,27 @@ void MADetectorConstruction::ConstructSDandField()
     // Also only add it once to the SD manager!
     G4SDManager::GetSDMpointer()->AddNewDetector(fSD.Get());
 
-    SetSensitiveDetector("TPC_log", fSD.Get());
-    SetSensitiveDetector("IB_log",  fSD.Get());
-    SetSensitiveDetector("OB_log",  fSD.Get());
+    // flag their volume codes for the stacking action
+    auto* store = G4LogicalVolumeStore::GetInstance();
+    for(const auto* name : { "TPC_log", "IB_log", "OB_log" })
+    {
+      G4LogicalVolume* lv = store->GetVolume(name);
+      SetSensitiveDetector(lv, fSD.Get());
+      MAVolumeCodes::SetSensitive(lv);
+    }
 
   }
   else
   {
     G4cout << " >>> fSD has entry. Repeated call." << G4endl;
   }
+
+  // per-thread fast simulation model of rock EM showers, if requested
+  if(fFastShower && !showerModel)
+  {
+    showerModel.reset(new MAEMShowerModel("RockEMShower",
+                                          G4RegionStore::GetInstance()->GetRegion("Rock")));
+  }
 }
 
 auto MADetectorConstruction::SetupCryostat() -> G4VPhysicalVolume*
@@ -156,8 +191,11 @@ auto MADetectorConstruction::SetupCryostat() -> G4VPhysicalVolume*
   G4double larside =
     tankhside - outerwall - insulation - innerwall;  // cube side of LAr volume
 
-  fvertexZ = (worldside - stone - 0.1) * cm;  // max vertex height
-  fmaxrad  = (hallrad + stone) * cm;          // max vertex circle radius
+  fvertexZ   = (worldside - stone - 0.1) * cm;     // max vertex height
+  fmaxrad    = (hallrad + stone) * cm;             // max vertex circle radius
+  fcavernhz  = (hallhheight + stone) * cm;         // cavern rock half height
+  ftankhside = tankhside * cm;                     // cryostat half side
+  ftankpos   = G4ThreeVector(0., 0., -offset * cm);  // cryostat centre
 
   // Volumes for this geometry
 
@@ -195,7 +233,7 @@ auto MADetectorConstruction::SetupCryostat() -> G4VPhysicalVolume*
   auto* tankSolid    = new G4Box("Tank", tankhside * cm, tankhside * cm, tankhside * cm);
   auto* fTankLogical = new G4LogicalVolume(tankSolid, steelMat, "Tank_log");
   auto* fTankPhysical =
-    new G4PVPlacement(nullptr, G4ThreeVector(0., 0., -offset * cm), fTankLogical,
+    new G4PVPlacement(nullptr, ftankpos, fTankLogical,
                       "Tank_phys", fHallLogical, false, 0, true);
 
   //
@@ -282,6 +320,32 @@ auto MADetectorConstruction::SetupCryostat() -> G4VPhysicalVolume*
   auto* fTPCPhysical = new G4PVPlacement(nullptr, G4ThreeVector(), fTPCLogical,
                                          "TPC_phys", fAcLogical, false, 0, true);
                                          
+  //
+  // Regions, coarse outside the argon and fine inside; the rock region
+  // also carries the EM shower model
+  //
+  AddToRegion("Rock", fCavernLogical, {fCavernLogical});
+  AddToRegion("Hall", fHallLogical, {fHallLogical});
+  AddToRegion("Cryostat", fTankLogical, {fTankLogical, fPuLogical, fMembraneLogical});
+  AddToRegion("Buffers", fLarLogical,
+              {fLarLogical, fCuLogical, fOBLogical, fAc2Logical, fIBLogical, fAcLogical});
+  AddToRegion("TPC", fTPCLogical, {fTPCLogical});
+
+  //
+  // Volume codes for the output, see README
+  //
+  MAVolumeCodes::Set(fCavernLogical, 0);
+  MAVolumeCodes::Set(fHallLogical, 1);
+  MAVolumeCodes::Set(fTankLogical, 2);
+  MAVolumeCodes::Set(fPuLogical, 3);
+  MAVolumeCodes::Set(fMembraneLogical, 4);
+  MAVolumeCodes::Set(fLarLogical, 5);
+  MAVolumeCodes::Set(fCuLogical, 6);
+  MAVolumeCodes::Set(fOBLogical, 7);
+  MAVolumeCodes::Set(fAc2Logical, 8);
+  MAVolumeCodes::Set(fIBLogical, 9);
+  MAVolumeCodes::Set(fAcLogical, 10);
+  MAVolumeCodes::Set(fTPCLogical, 11);
 
   //
   // Visualization attributes
@@ -314,6 +378,126 @@ void MADetectorConstruction::ExportGeometry(const G4String& file)
   parser.Write(file);
 }
 
+void MADetectorConstruction::DefineRegions()
+{
+  // regions exist before the geometry, so region commands work at PreInit
+  for(const auto* name : { "Rock", "Hall", "Cryostat", "Buffers", "TPC" })
+  {
+    RegionSetting setting;
+    setting.region = new G4Region(name);
+    setting.limits = new G4UserLimits;
+    setting.region->SetUserLimits(setting.limits);
+    fRegions.push_back(setting);
+  }
+}
+
+void MADetectorConstruction::AddToRegion(const G4String& name, G4LogicalVolume* root,
+                                         std::initializer_list<G4LogicalVolume*> volumes)
+{
+  // G4UserSpecialCuts reads the limits from the logical volume, not the region
+  auto* region = G4RegionStore::GetInstance()->GetRegion(name);
+  region->AddRootLogicalVolume(root);
+  for(auto* lv : volumes)
+  {
+    lv->SetUserLimits(region->GetUserLimits());
+  }
+}
+
+auto MADetectorConstruction::ParseRegion(const G4String& args, const G4String& category,
+                                         G4double& value) -> RegionSetting*
+{
+  // region value unit
+  std::istringstream is(args);
+  G4String           name, unit;
+  RegionSetting*     setting = nullptr;
+  if((is >> name >> value >> unit) && value >= 0. &&
+     G4UIcommand::CategoryOf(unit) == category)
+  {
+    for(auto& s : fRegions)
+    {
+      if(s.region->GetName() == name)
+      {
+        setting = &s;
+      }
+    }
+    value *= G4UIcommand::ValueOf(unit);
+  }
+  if(setting == nullptr)
+  {
+    G4ExceptionDescription msg;
+    msg << "Bad region setting '" << args << "', expect Region value unit ("
+        << category << ") with Region one of Rock Hall Cryostat Buffers TPC";
+    G4Exception("MADetectorConstruction::ParseRegion()", "MyCode0010", JustWarning, msg);
+  }
+  return setting;
+}
+
+void MADetectorConstruction::SetRegionCut(const G4String& args)
+{
+  G4double value   = 0.;
+  auto*    setting = ParseRegion(args, "Length", value);
+  if(setting == nullptr)
+  {
+    return;
+  }
+  // until set, the region shares the default cuts; never change those here
+  if(setting->cut < 0.)
+  {
+    setting->region->SetProductionCuts(new G4ProductionCuts);
+  }
+  setting->region->GetProductionCuts()->SetProductionCut(value);
+  setting->cut = value;
+}
+
+void MADetectorConstruction::SetRegionMaxTime(const G4String& args)
+{
+  G4double value   = 0.;
+  auto*    setting = ParseRegion(args, "Time", value);
+  if(setting != nullptr)
+  {
+    setting->limits->SetUserMaxTime(value);
+    setting->maxTime = value;
+  }
+}
+
+void MADetectorConstruction::SetRegionMinEkin(const G4String& args)
+{
+  G4double value   = 0.;
+  auto*    setting = ParseRegion(args, "Energy", value);
+  if(setting != nullptr)
+  {
+    setting->limits->SetUserMinEkine(value);
+    setting->minEkin = value;
+  }
+}
+
+void MADetectorConstruction::PrintRegions()
+{
+  G4cout << "--- Regions: production cut, max track time, min kinetic energy" << G4endl;
+  for(const auto& s : fRegions)
+  {
+    G4cout << "    " << s.region->GetName() << ": ";
+    if(s.cut < 0.)
+    {
+      G4cout << "default";
+    }
+    else
+    {
+      G4cout << G4BestUnit(s.cut, "Length");
+    }
+    G4cout << ", ";
+    if(s.maxTime == DBL_MAX)
+    {
+      G4cout << "none";
+    }
+    else
+    {
+      G4cout << G4BestUnit(s.maxTime, "Time");
+    }
+    G4cout << ", " << G4BestUnit(s.minEkin, "Energy") << G4endl;
+  }
+}
+
 void MADetectorConstruction::DefineCommand()
 {
   // Define geometry command directory using generic messenger class
@@ -327,4 +511,31 @@ void MADetectorConstruction::DefineCommand()
     .SetDefaultValue("wlgd.gdml")
     .SetStates(G4State_Idle)
     .SetToBeBroadcasted(false);
+
+  // per-region cuts and limits live on the shared geometry, master only
+  fRegionMessenger = new G4GenericMessenger(
+    this, "/MA/detector/region/",
+    "Production cuts and user limits of the Rock, Hall, Cryostat, Buffers and TPC regions");
+  fRegionMessenger->DeclareMethod("cut", &MADetectorConstruction::SetRegionCut)
+    .SetGuidance("Production cut of a region for gamma, e-, e+ and proton")
+    .SetGuidance("Region value unit, e.g. Rock 1 m; unset regions use /run/setCut")
+    .SetParameterName("setting", false)
+    .SetStates(G4State_PreInit, G4State_Idle)
+    .SetToBeBroadcasted(false);
+  fRegionMessenger->DeclareMethod("maxTime", &MADetectorConstruction::SetRegionMaxTime)
+    .SetGuidance("Kill tracks in a region beyond this global time")
+    .SetGuidance("Region value unit, e.g. Rock 10 us")
+    .SetParameterName("setting", false)
+    .SetStates(G4State_PreInit, G4State_Idle)
+    .SetToBeBroadcasted(false);
+  fRegionMessenger->DeclareMethod("minEkin", &MADetectorConstruction::SetRegionMinEkin)
+    .SetGuidance("Kill charged tracks in a region below this kinetic energy")
+    .SetGuidance("Region value unit, e.g. Hall 1 MeV")
+    .SetParameterName("setting", false)
+    .SetStates(G4State_PreInit, G4State_Idle)
+    .SetToBeBroadcasted(false);
+  fRegionMessenger->DeclareMethod("print", &MADetectorConstruction::PrintRegions)
+    .SetGuidance("Print the region cuts and limits")
+    .SetStates(G4State_PreInit, G4State_Idle)
+    .SetToBeBroadcasted(false);
 }
@@ -0,0 +1,175 @@
+#include "MAEMShowerModel.hh"
+
+#include "G4AffineTransform.hh"
+#include "G4Electron.hh"
+#include "G4Gamma.hh"
+#include "G4LogicalVolume.hh"
+#include "G4Material.hh"
+#include "G4Neutron.hh"
+#include "G4Poisson.hh"
+#include "G4Positron.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4VPhysicalVolume.hh"
+#include "Randomize.hh"
+
+#include <algorithm>
+#include <cmath>
+
+MAEMShowerModel::MAEMShowerModel(const G4String& name, G4Region* region)
+: G4VFastSimulationModel(name, region)
+, fThreshold(1. * GeV)
+, fNeutronYield(0.0194 * std::pow(11., 0.66))
+, fTemperature(1.5 * MeV)
+, fCriticalEnergy(49. * MeV)  // standard rock, 610 MeV / (Z + 1.24)
+{
+  DefineCommands();
+}
+
+MAEMShowerModel::~MAEMShowerModel() { delete fMessenger; }
+
+G4bool MAEMShowerModel::IsApplicable(const G4ParticleDefinition& particle)
+{
+  return &particle == G4Electron::Definition() || &particle == G4Positron::Definition() ||
+         &particle == G4Gamma::Definition();
+}
+
+G4bool MAEMShowerModel::ModelTrigger(const G4FastTrack& fastTrack)
+{
+  return fastTrack.GetPrimaryTrack()->GetKineticEnergy() > fThreshold;
+}
+
+void MAEMShowerModel::DoIt(const G4FastTrack& fastTrack, G4FastStep& fastStep)
+{
+  if(fSpectrumT != fTemperature)
+    BuildSpectrum();
+
+  const G4Track* track  = fastTrack.GetPrimaryTrack();
+  G4double       energy = track->GetKineticEnergy();
+  G4bool         photon = (track->GetDefinition() == G4Gamma::Definition());
+
+  fastStep.KillPrimaryTrack();
+  fastStep.ProposePrimaryTrackPathLength(0.);
+
+  // photoneutrons of the shower
+  G4int n = G4Poisson(fNeutronYield * energy / GeV);
+  fastStep.SetNumberOfSecondaryTracks(n);
+
+  // emission depth along the axis, up to the first rock boundary
+  G4ThreeVector pos = fastTrack.GetPrimaryTrackLocalPosition();
+  G4ThreeVector dir = fastTrack.GetPrimaryTrackLocalDirection();
+  G4double      out = DistanceToBoundary(fastTrack, pos, dir);
+  G4double      X0  = fastTrack.GetEnvelopeLogicalVolume()->GetMaterial()->GetRadlen();
+
+  G4double emitted = 0.;
+  for(G4int i = 0; i < n; ++i)
+  {
+    G4double ekin = fSpectrum.Sample(G4UniformRand()) * MeV;
+    if(emitted + ekin > energy)
+      break;
+    emitted += ekin;
+
+    G4double      depth    = std::min(SampleDepth(energy, photon) * X0, 0.999 * out);
+    G4double      cost     = 2. * G4UniformRand() - 1.;
+    G4double      sint     = std::sqrt(1. - cost * cost);
+    G4double      phi      = CLHEP::twopi * G4UniformRand();
+    G4ThreeVector emission = G4ThreeVector(sint * std::cos(phi), sint * std::sin(phi), cost);
+
+    G4DynamicParticle neutron(G4Neutron::Definition(), emission, ekin);
+    fastStep.CreateSecondaryTrack(neutron, pos + depth * dir, track->GetGlobalTime());
+  }
+
+  fastStep.ProposeTotalEnergyDeposited(energy - emitted);
+}
+
+G4double MAEMShowerModel::DistanceToBoundary(const G4FastTrack&  fastTrack,
+                                             const G4ThreeVector& pos,
+                                             const G4ThreeVector& dir) const
+{
+  // the envelope solid knows nothing of its daughters, e.g. the hall
+  G4double               out      = fastTrack.GetEnvelopeSolid()->DistanceToOut(pos, dir);
+  const G4LogicalVolume* envelope = fastTrack.GetEnvelopeLogicalVolume();
+  for(G4int i = 0; i < envelope->GetNoDaughters(); ++i)
+  {
+    const G4VPhysicalVolume* daughter = envelope->GetDaughter(i);
+    G4AffineTransform        toDaughter(daughter->GetRotation(), daughter->GetTranslation());
+    toDaughter.Invert();
+    out = std::min(out, daughter->GetLogicalVolume()->GetSolid()->DistanceToIn(
+                          toDaughter.TransformPoint(pos), toDaughter.TransformAxis(dir)));
+  }
+  return out;
+}
+
+G4double MAEMShowerModel::SampleDepth(G4double energy, G4bool photon) const
+{
+  // longitudinal profile t^(a-1) exp(-b t), t in radiation lengths, with
+  // the maximum at ln(E/Ec) - 0.5 for electrons and + 0.5 for photons
+  const G4double b    = 0.5;
+  G4double       tmax = std::max(std::log(energy / fCriticalEnergy) + (photon ? 0.5 : -0.5), 0.);
+  G4double       a    = b * tmax + 1.;
+
+  // Gamma(a) as a sum of Gamma(1) variates plus a Gamma(frac) by
+  // Ahrens-Dieter rejection, a stays small
+  G4int    k = G4int(a);
+  G4double x = 0.;
+  for(G4int i = 0; i < k; ++i)
+    x -= std::log(1. - G4UniformRand());
+
+  G4double frac = a - k;
+  if(frac > 0.)
+  {
+    const G4double e = std::exp(1.);
+    while(true)
+    {
+      G4double u = G4UniformRand();
+      G4double v = 1. - G4UniformRand();
+      G4double w = G4UniformRand();
+      G4double y, accept;
+      if(u <= e / (e + frac))
+      {
+        y      = std::pow(v, 1. / frac);
+        accept = std::exp(-y);
+      }
+      else
+      {
+        y      = 1. - std::log(v);
+        accept = std::pow(y, frac - 1.);
+      }
+      if(w <= accept)
+      {
+        x += y;
+        break;
+      }
+    }
+  }
+  return x / b;
+}
+
+void MAEMShowerModel::BuildSpectrum()
+{
+  // giant-dipole evaporation spectrum, up to ten temperatures
+  G4double T  = fTemperature / MeV;
+  fSpectrum   = MASamplingTable(200, 0., 10. * T, [T](double e) { return e * std::exp(-e / T); });
+  fSpectrumT  = fTemperature;
+}
+
+void MAEMShowerModel::DefineCommands()
+{
+  fMessenger = new G4GenericMessenger(this, "/MA/fastsim/", "Rock EM shower model control");
+
+  auto& thresholdCmd = fMessenger->DeclarePropertyWithUnit(
+    "threshold", "GeV", fThreshold, "Energy above which rock EM showers are parameterised");
+  thresholdCmd.SetParameterName("E", true);
+  thresholdCmd.SetRange("E>=0.");
+  thresholdCmd.SetDefaultValue("1.");
+
+  auto& yieldCmd = fMessenger->DeclareProperty("neutronYield", fNeutronYield,
+                                               "Photoneutrons per GeV of shower energy");
+  yieldCmd.SetParameterName("y", true);
+  yieldCmd.SetRange("y>=0.");
+
+  auto& tempCmd = fMessenger->DeclarePropertyWithUnit(
+    "temperature", "MeV", fTemperature, "Nuclear temperature of the photoneutron spectrum");
+  tempCmd.SetParameterName("T", true);
+  tempCmd.SetRange("T>0.");
+  tempCmd.SetDefaultValue("1.5");
+}
@@ -2,14 +2,23 @@
 #include "MATrajectory.hh"
 #include "g4root.hh"
 
+#include "G4AccumulableManager.hh"
 #include "G4Event.hh"
 #include "G4HCofThisEvent.hh"
+#include "G4RunManager.hh"
 #include "G4SDManager.hh"
 #include "G4TrajectoryContainer.hh"
+#include "G4VProcess.hh"
 #include "G4UnitsTable.hh"
 #include "G4ios.hh"
 
+#include "MAConvergenceMonitor.hh"
+#include "MAIsotopeYields.hh"
 #include "MALiquidSD.hh"
+#include "MANtupleLayout.hh"
+#include "MARunAction.hh"
+#include "MAPrimaryGeneratorAction.hh"
+#include "MAStackingAction.hh"
 
 #include "Randomize.hh"
 #include <algorithm>
@@ -35,161 +44,262 @@ MALiquidHitsCollection* MAEventAction::GetHitsCollection(G4int hcID,
 }    
 
 
-void MAEventAction::makeMap()
+void MAEventAction::FillReal(G4int ntuple, G4int column, G4double value) const
 {
-  // make a lookup table to translate Logical Volume name
-  // to a unique int for storage in the ntuple.
-  lookup["Cavern_log"]   = 0;
-  lookup["Hall_log"]     = 1;
-  lookup["Tank_log"]     = 2;
-  lookup["Pu_log"]       = 3;
-  lookup["Membrane_log"] = 4;
-  lookup["Lar_log"]      = 5;
-  lookup["Cu_log"]       = 6;
-  lookup["OB_log"]       = 7;
-  lookup["Ac2_log"]      = 8;
-  lookup["IB_log"]       = 9;
-  lookup["Ac_log"]       = 10;
-  lookup["TPC_log"]      = 11;
+  auto analysisManager = G4AnalysisManager::Instance();
+  if(fFloat)
+    analysisManager->FillNtupleFColumn(ntuple, column, G4float(value));
+  else
+    analysisManager->FillNtupleDColumn(ntuple, column, value);
 }
 
-G4int MAEventAction::GeomID(G4String name)
+MAEventAction::MAEventAction(MATrackHistory* history)
+: fHistory(history)
 {
-  auto it = lookup.find(name);
+  DefineCommands();
+}
 
-  if(it == lookup.end())
-  {
-    G4ExceptionDescription msg;
-    msg << "Name  " << name << " not in look up table";
-    G4Exception("MAEventAction::GeomID()", "MyCode0005", FatalException, msg);
-  }
-  return it->second;
+MAEventAction::~MAEventAction()
+{
+  delete fMessenger;
+  delete fHistory;
+}
+
+void MAEventAction::DefineCommands()
+{
+  // Define /MA/output command directory using generic messenger class
+  fMessenger = new G4GenericMessenger(this, "/MA/output/", "Output control");
+
+  fMessenger->DeclareProperty("ancestry", fAncestry)
+    .SetGuidance("Hit track histories: full chain per hit in Traj, or each track")
+    .SetGuidance("once per event in Node, referenced by the NodeID of Score rows.")
+    .SetCandidates("chain tree")
+    .SetDefaultValue("chain");
+
+  fMessenger->DeclareProperty("trackHistory", fRecordHistory)
+    .SetGuidance("Record track histories for the ancestry output in a flat table,")
+    .SetGuidance("without /tracking/storeTrajectory.")
+    .SetDefaultValue("true");
 }
 
 void MAEventAction::BeginOfEventAction(const G4Event*
                                          /*event*/)
 {
-  makeMap();
+  fHistory->Clear();
+  fHistory->SetEnabled(fRecordHistory);
 }
 
 void MAEventAction::EndOfEventAction(const G4Event* event)
 {
-  // Get liquid hits collections IDs
+  using namespace MANtuple;
+
+  // no primaries, e.g. primary file exhausted: neither output nor
+  // normalisation
+  if(event->IsAborted())
+    return;
+
+  // Get liquid hits collections IDs, the detector and the yields, once
   if(fHID < 0)
-    fHID   = G4SDManager::GetSDMpointer()->GetCollectionID("LiquidHitsCollection");
+  {
+    fHID    = G4SDManager::GetSDMpointer()->GetCollectionID("LiquidHitsCollection");
+    fSD     = static_cast<MALiquidSD*>(
+      G4SDManager::GetSDMpointer()->FindSensitiveDetector("LiquidSD", false));
+    fYields = static_cast<MAIsotopeYields*>(
+      G4AccumulableManager::Instance()->GetAccumulable("IsotopeYields", false));
+  }
 
 
   // Get entries from hits collections
   //
   auto CrysHC   = GetHitsCollection(fHID, event);
 
-  if(CrysHC->entries() <= 0)
+  // get analysis manager
+  auto analysisManager = G4AnalysisManager::Instance();
+
+  // output tier, compact and summary columns are float
+  MAOutputLevel level = MARunAction::GetOutputLevel();
+  fFloat              = (level != MAOutputLevel::full);
+
+  G4int eventID = event->GetEventID();
+
+  // statistical weight from importance sampling in the generator
+  auto generator = dynamic_cast<const MAPrimaryGeneratorAction*>(
+    G4RunManager::GetRunManager()->GetUserPrimaryGeneratorAction());
+  G4double weight = (generator != nullptr) ? generator->GetEventWeight() : 1.0;
+
+  // nuclei recorded at creation, independent of hits
+  auto stacking = dynamic_cast<const MAStackingAction*>(
+    G4RunManager::GetRunManager()->GetUserStackingAction());
+  if(stacking != nullptr && level != MAOutputLevel::summary)
   {
-    return;  // no action on no hit
+    for(const auto& iso : stacking->GetIsotopes())
+    {
+      analysisManager->FillNtupleIColumn(kIso, Iso::EventID, eventID);
+      analysisManager->FillNtupleIColumn(kIso, Iso::TrackID, iso.tid);
+      analysisManager->FillNtupleIColumn(kIso, Iso::IonZ, iso.Z);
+      analysisManager->FillNtupleIColumn(kIso, Iso::IonA, iso.A);
+      FillReal(kIso, Iso::Excitation, iso.excitation / kExcitation);
+      analysisManager->FillNtupleIColumn(kIso, Iso::VCode, iso.vcode);
+      FillReal(kIso, Iso::Time, iso.time / kTime);
+      FillReal(kIso, Iso::X, iso.vertex.x() / kLength);
+      FillReal(kIso, Iso::Y, iso.vertex.y() / kLength);
+      FillReal(kIso, Iso::Z, iso.vertex.z() / kLength);
+      analysisManager->FillNtupleSColumn(kIso, Iso::Creator,
+        (iso.creator != nullptr) ? iso.creator->GetProcessName() : G4String("primary"));
+      FillReal(kIso, Iso::Weight, weight);
+      analysisManager->AddNtupleRow(kIso);
+    }
   }
 
-  // dummy storage
-  std::vector<int> thid, tz, ta;
-  std::vector<double> ttime, ted, tx, ty, tzloc;
-  std::vector<G4String> tname;
+  // in-run yields of nuclei recorded at creation, with their normalisation
+  if(fYields != nullptr)
+  {
+    if(stacking != nullptr)
+    {
+      for(const auto& iso : stacking->GetIsotopes())
+        fYields->Fill(iso.Z, iso.A, iso.vcode, weight);
+    }
+    fYields->EndOfEvent();
+    // one muon event, also for a bundle or a replayed hall-entry event
+    fYields->AddPrimaries(weight);
 
-  // get analysis manager
-  auto analysisManager = G4AnalysisManager::Instance();
+    if(fSD != nullptr)
+    {
+      const auto& depth = fSD->GetColumnDepth();
+      for(G4int vcode = 0; vcode < (G4int) depth.size(); ++vcode)
+        fYields->AddColumnDepth(vcode, weight * depth[vcode]);
+    }
+  }
 
-  // fill Hits output from SD
-  G4int nofHits = CrysHC->entries();
+  // soft abort once the target isotopes have converged
+  if(stacking != nullptr && MAConvergenceMonitor::AddEvent(stacking->GetIsotopes(), weight))
+    G4RunManager::GetRunManager()->AbortRun(true);
 
-  for ( G4int i=0; i<nofHits; i++ ) 
+  // per-event scalars, compact and summary output
+  G4int nofHits     = CrysHC->entries();
+  G4int nofIsotopes = (stacking != nullptr) ? stacking->GetIsotopes().size() : 0;
+  if(level != MAOutputLevel::full && (nofHits > 0 || nofIsotopes > 0))
   {
-    auto hh = (*CrysHC)[i];
-
-    thid.push_back(hh->GetTID());
-    tz.push_back(hh->GetIonZ());
-    ta.push_back(hh->GetIonA());
-    tname.push_back(hh->GetVName());
-    ttime.push_back(hh->GetTime()   / G4Analysis::GetUnitValue("ns"));
-    ted.push_back(hh->GetEdep()     / G4Analysis::GetUnitValue("MeV"));
-    tx.push_back((hh->GetPos()).x() / G4Analysis::GetUnitValue("m"));
-    ty.push_back((hh->GetPos()).y() / G4Analysis::GetUnitValue("m"));
-    tzloc.push_back((hh->GetPos()).z() / G4Analysis::GetUnitValue("m"));
+    G4double edep = 0.;
+    for(G4int i = 0; i < nofHits; ++i)
+      edep += (*CrysHC)[i]->GetEdep();
+
+    analysisManager->FillNtupleIColumn(kEvent, Event::EventID, eventID);
+    analysisManager->FillNtupleIColumn(kEvent, Event::NHits, nofHits);
+    analysisManager->FillNtupleIColumn(kEvent, Event::NIsotopes, nofIsotopes);
+    FillReal(kEvent, Event::Edep, edep / kEnergy);
+    FillReal(kEvent, Event::Weight, weight);
+    analysisManager->AddNtupleRow(kEvent);
   }
 
-  // fill the ntuple
-  G4int eventID = event->GetEventID();
-  for (unsigned int i=0;i<ted.size();i++)
+  if(nofHits <= 0 || level == MAOutputLevel::summary)
   {
-    analysisManager->FillNtupleIColumn(0, 0, eventID); // repeat all rows
-    analysisManager->FillNtupleIColumn(0, 1, thid.at(i));
-    analysisManager->FillNtupleIColumn(0, 2, tz.at(i));
-    analysisManager->FillNtupleIColumn(0, 3, ta.at(i));
-    analysisManager->FillNtupleIColumn(0, 4, GeomID(tname.at(i)));
-    analysisManager->FillNtupleDColumn(0, 5, ted.at(i));
-    analysisManager->FillNtupleDColumn(0, 6, ttime.at(i));
-    analysisManager->FillNtupleDColumn(0, 7, tx.at(i));
-    analysisManager->FillNtupleDColumn(0, 8, ty.at(i));
-    analysisManager->FillNtupleDColumn(0, 9, tzloc.at(i)); // same size
-    analysisManager->AddNtupleRow(0);
+    return;  // no action on no hit
   }
 
-  // fill trajectory data
-
-  // fill trajectory data if available
+  // track histories, from the recorder or else from stored trajectories
   G4TrajectoryContainer* trajectoryContainer = event->GetTrajectoryContainer();
   G4int                  n_trajectories =
     (trajectoryContainer == nullptr) ? 0 : trajectoryContainer->entries();
-
-  std::vector<int> res;
-  if(n_trajectories > 0)
+  if(fHistory->size() == 0)
   {
-    // temporary full storage
-    std::vector<G4int>    temptid, temppid, temppdg;
-    std::vector<G4String> tempname;
-    std::vector<G4double> tempxvtx, tempyvtx, tempzvtx;
-
-
     for(G4int i = 0; i < n_trajectories; i++)
     {
       MATrajectory* trj = (MATrajectory*) ((*(event->GetTrajectoryContainer()))[i]);
-      temptid.push_back(trj->GetTrackID());
-      temppid.push_back(trj->GetParentID());
-      temppdg.push_back(trj->GetPDGEncoding());
-      tempname.push_back(trj->GetVertexName());
-      tempxvtx.push_back((trj->GetVertex()).x());
-      tempyvtx.push_back((trj->GetVertex()).y());
-      tempzvtx.push_back((trj->GetVertex()).z());
+      fHistory->Add(trj->GetTrackID(), trj->GetParentID(), trj->GetPDGEncoding(),
+                    trj->GetVertexCode(), trj->GetVertex());
     }
+  }
+  G4int n_tracks = fHistory->size();
 
-    // store filtered trajectories only
-    for(const int& item : thid)
+  const auto& temptid  = fHistory->GetTrackID();
+  const auto& temppid  = fHistory->GetParentID();
+  const auto& temppdg  = fHistory->GetPDG();
+  const auto& tempcode = fHistory->GetVertexCode();
+  const auto& tempxvtx = fHistory->GetX();
+  const auto& tempyvtx = fHistory->GetY();
+  const auto& tempzvtx = fHistory->GetZ();
+  fIndex.Build(temptid, temppid);
+  fNodeOf.assign(n_tracks, -1);
+
+  // compact output is always deduplicated
+  G4String ancestry = (level == MAOutputLevel::compact) ? G4String("tree") : fAncestry;
+  G4bool   tree     = (ancestry == "tree" && n_tracks > 0);
+
+  // one pass over the hits: Score row, straight from the hit, after the
+  // tree mode nodes of its history; every track on a hit history is
+  // stored once, as a node, and the leaf node goes to the Score row
+  G4int nodes = 0;
+  for(G4int i = 0; i < nofHits; ++i)
+  {
+    const MALiquidHit* hit  = (*CrysHC)[i];
+    G4int              leaf = -1;
+    if(tree)
     {
-      res = FilterTrajectories(item, temptid, temppid);
-      for(int& idx : res)
+      int item = hit->GetTID();
+      int idx  = fIndex.Position(item);
+
+      // new nodes up to the first ancestor already stored
+      for(int link = idx; link >= 0 && fNodeOf[link] < 0; link = fIndex.Parent(link))
       {
-	analysisManager->FillNtupleIColumn(1, 0, eventID); // repeat all rows
-	analysisManager->FillNtupleIColumn(1, 1, temptid.at(idx));
-	analysisManager->FillNtupleIColumn(1, 2, temppid.at(idx));
-	analysisManager->FillNtupleIColumn(1, 3, temppdg.at(idx));
-	analysisManager->FillNtupleIColumn(1, 4, GeomID(tempname.at(idx)));
-	analysisManager->FillNtupleDColumn(1, 5, tempxvtx.at(idx));
-	analysisManager->FillNtupleDColumn(1, 6, tempyvtx.at(idx));
-	analysisManager->FillNtupleDColumn(1, 7, tempzvtx.at(idx));
-        analysisManager->AddNtupleRow(1);
+        fNodeOf[link] = nodes++;
+        analysisManager->FillNtupleIColumn(kNode, Node::EventID, eventID);
+        analysisManager->FillNtupleIColumn(kNode, Node::NodeID, fNodeOf[link]);
+        analysisManager->FillNtupleIColumn(kNode, Node::TrackID, temptid[link]);
+        analysisManager->FillNtupleIColumn(kNode, Node::ParentID, temppid[link]);
+        analysisManager->FillNtupleIColumn(kNode, Node::PDG, temppdg[link]);
+        analysisManager->FillNtupleIColumn(kNode, Node::VCode, tempcode[link]);
+        FillReal(kNode, Node::X, tempxvtx[link] / kVertex);
+        FillReal(kNode, Node::Y, tempyvtx[link] / kVertex);
+        FillReal(kNode, Node::Z, tempzvtx[link] / kVertex);
+        FillReal(kNode, Node::Weight, weight);
+        analysisManager->AddNtupleRow(kNode);
       }
+      leaf = (idx >= 0) ? fNodeOf[idx] : -1;
     }
-    temptid.clear();
-    temppid.clear();
-    temppdg.clear();
-    tempname.clear();
-    tempxvtx.clear();
-    tempyvtx.clear();
-    tempzvtx.clear();
 
-    trajectoryContainer->clearAndDestroy();
+    const G4ThreeVector& pos = hit->GetPos();
+    analysisManager->FillNtupleIColumn(kScore, Score::EventID, eventID);
+    analysisManager->FillNtupleIColumn(kScore, Score::HitID, hit->GetTID());
+    analysisManager->FillNtupleIColumn(kScore, Score::IonZ, hit->GetIonZ());
+    analysisManager->FillNtupleIColumn(kScore, Score::IonA, hit->GetIonA());
+    analysisManager->FillNtupleIColumn(kScore, Score::VCode, hit->GetVCode());
+    FillReal(kScore, Score::Edep, hit->GetEdep() / kEnergy);
+    FillReal(kScore, Score::Time, hit->GetTime() / kTime);
+    FillReal(kScore, Score::X, pos.x() / kLength);
+    FillReal(kScore, Score::Y, pos.y() / kLength);
+    FillReal(kScore, Score::Z, pos.z() / kLength);
+    FillReal(kScore, Score::Weight, weight);
+    analysisManager->FillNtupleIColumn(kScore, Score::NodeID, leaf);
+    analysisManager->AddNtupleRow(kScore);
   }
 
+  // chain mode: store filtered trajectories only, full history per hit
+  if(ancestry == "chain" && n_tracks > 0)
+  {
+    for(G4int i = 0; i < nofHits; ++i)
+    {
+      const auto& res = fIndex.Chain((*CrysHC)[i]->GetTID());
+      for(const int& idx : res)
+      {
+        analysisManager->FillNtupleIColumn(kTraj, Traj::EventID, eventID);
+        analysisManager->FillNtupleIColumn(kTraj, Traj::HitID, temptid[idx]);
+        analysisManager->FillNtupleIColumn(kTraj, Traj::ParentID, temppid[idx]);
+        analysisManager->FillNtupleIColumn(kTraj, Traj::PDG, temppdg[idx]);
+        analysisManager->FillNtupleIColumn(kTraj, Traj::VCode, tempcode[idx]);
+        FillReal(kTraj, Traj::X, tempxvtx[idx] / kVertex);
+        FillReal(kTraj, Traj::Y, tempyvtx[idx] / kVertex);
+        FillReal(kTraj, Traj::Z, tempzvtx[idx] / kVertex);
+        FillReal(kTraj, Traj::Weight, weight);
+        analysisManager->AddNtupleRow(kTraj);
+      }
+    }
+  }
+  if(trajectoryContainer != nullptr)
+    trajectoryContainer->clearAndDestroy();
+
   // printing
   // G4cout << ">>> Event: " << eventID << G4endl;
   // G4cout << "    " << nofHits << " hits stored in this event." << G4endl;
-  // G4cout << "    " << res.size() << " trajectories after filter." << G4endl;
-  res.clear();
+  // G4cout << "    " << fIndex.GetSteps() << " ancestry links walked." << G4endl;
 }
@@ -0,0 +1,51 @@
+#include "MAHitTable.hh"
+
+int& MAHitTable::Hit(int tid)
+{
+  // grow at half load
+  if(2 * (fUsed.size() + 1) > fSlots.size())
+    Grow();
+
+  // linear probing
+  std::size_t mask = fSlots.size() - 1;
+  std::size_t i    = Home(tid);
+  while(fSlots[i].tid != 0)
+  {
+    if(fSlots[i].tid == tid)
+      return fSlots[i].hit;
+    i = (i + 1) & mask;
+  }
+
+  fSlots[i].tid = tid;
+  fSlots[i].hit = -1;
+  fUsed.push_back(i);
+  return fSlots[i].hit;
+}
+
+void MAHitTable::Clear()
+{
+  for(std::size_t i : fUsed)
+    fSlots[i] = Slot();
+  fUsed.clear();
+}
+
+void MAHitTable::Grow()
+{
+  // re-insert the occupied slots
+  std::vector<Slot> old;
+  old.swap(fSlots);
+  fSlots.assign(old.empty() ? 64 : 2 * old.size(), Slot());
+  fUsed.clear();
+
+  std::size_t mask = fSlots.size() - 1;
+  for(const auto& s : old)
+  {
+    if(s.tid == 0)
+      continue;
+    std::size_t i = Home(s.tid);
+    while(fSlots[i].tid != 0)
+      i = (i + 1) & mask;
+    fSlots[i] = s;
+    fUsed.push_back(i);
+  }
+}
@@ -0,0 +1,103 @@
+#include "MAIsotopeYields.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+MAIsotopeYields::MAIsotopeYields(const G4String& name)
+: G4VAccumulable(name)
+, fSum(std::size_t(kMaxZ + 1) * (kMaxN + 1) * kVolumes, 0.)
+, fSum2(fSum.size(), 0.)
+, fEvent(fSum.size(), 0.)
+, fDepth(kVolumes, 0.)
+{}
+
+void MAIsotopeYields::Merge(const G4VAccumulable& other)
+{
+  const auto& rhs = static_cast<const MAIsotopeYields&>(other);
+  for(std::size_t i = 0; i < fSum.size(); ++i)
+  {
+    fSum[i] += rhs.fSum[i];
+    fSum2[i] += rhs.fSum2[i];
+  }
+  for(std::size_t i = 0; i < fDepth.size(); ++i)
+    fDepth[i] += rhs.fDepth[i];
+  fEvents += rhs.fEvents;
+  fPrimaries += rhs.fPrimaries;
+  fOverflow += rhs.fOverflow;
+}
+
+void MAIsotopeYields::Reset()
+{
+  for(auto* v : { &fSum, &fSum2, &fEvent, &fDepth })
+    std::fill(v->begin(), v->end(), 0.);
+  fTouched.clear();
+  fEvents    = 0;
+  fPrimaries = 0.;
+  fOverflow  = 0.;
+}
+
+void MAIsotopeYields::Fill(G4int Z, G4int A, G4int vcode, G4double weight)
+{
+  G4int N = A - Z;
+  if(Z < 0 || Z > kMaxZ || N < 0 || N > kMaxN || vcode < -1 || vcode + 1 >= kVolumes)
+  {
+    fOverflow += weight;
+    return;
+  }
+  std::size_t i = Index(Z, N, vcode + 1);
+  fSum[i] += weight;
+  if(fEvent[i] == 0.)
+    fTouched.push_back(i);
+  fEvent[i] += weight;
+}
+
+void MAIsotopeYields::EndOfEvent()
+{
+  for(std::size_t i : fTouched)
+  {
+    fSum2[i] += fEvent[i] * fEvent[i];
+    fEvent[i] = 0.;
+  }
+  fTouched.clear();
+}
+
+G4double MAIsotopeYields::GetCount(G4int Z, G4int A, G4int vcode) const
+{
+  return fSum[Index(Z, A - Z, vcode + 1)];
+}
+
+G4double MAIsotopeYields::GetError(G4int Z, G4int A, G4int vcode) const
+{
+  return std::sqrt(fSum2[Index(Z, A - Z, vcode + 1)]);
+}
+
+void MAIsotopeYields::Print(std::ostream& os) const
+{
+  os << "# isotope yields: " << fEvents << " primary events, " << fPrimaries
+     << " weighted";
+  if(fOverflow > 0.)
+    os << ", " << fOverflow << " weighted nuclei out of table range";
+  os << "\n# Z A VCode Count Error PerPrimary PerGcm2\n";
+
+  for(G4int Z = 0; Z <= kMaxZ; ++Z)
+  {
+    for(G4int N = 0; N <= kMaxN; ++N)
+    {
+      for(G4int slot = 0; slot < kVolumes; ++slot)
+      {
+        std::size_t i = Index(Z, N, slot);
+        if(fSum[i] <= 0.)
+          continue;
+
+        // per g/cm2 only where primaries crossed a sensitive volume
+        G4double perPrimary = (fPrimaries > 0.) ? fSum[i] / fPrimaries : 0.;
+        G4double perDepth   = (fDepth[slot] > 0.) ? fSum[i] / fDepth[slot] : 0.;
+        os << std::setw(3) << Z << " " << std::setw(3) << Z + N << " " << std::setw(3)
+           << slot - 1 << " " << std::setw(12) << fSum[i] << " " << std::setw(12)
+           << std::sqrt(fSum2[i]) << " " << std::setw(12) << perPrimary << " "
+           << std::setw(12) << perDepth << "\n";
+      }
+    }
+  }
+}
@@ -1,10 +1,18 @@
 #include "MALiquidSD.hh"
+#include "MARunAction.hh"
+#include "MAStackingAction.hh"
+#include "MAVolumeCodes.hh"
 #include "G4HCofThisEvent.hh"
+#include "G4Material.hh"
 #include "G4Step.hh"
 #include "G4ThreeVector.hh"
 #include "G4SDManager.hh"
+#include "G4SystemOfUnits.hh"
 #include "G4ios.hh"
 
+#include <algorithm>
+#include <cstdlib>
+
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
 MALiquidSD::MALiquidSD(const G4String& name,
@@ -13,12 +21,48 @@ MALiquidSD::MALiquidSD(const G4String& name,
    fHitsCollection(NULL)
 {
   collectionName.insert(hitsCollectionName);
+  fColumnDepth.assign(MAVolumeCodes::kNumCodes, 0.);
+  DefineCommands();
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
 MALiquidSD::~MALiquidSD() 
-{}
+{
+  delete fMessenger;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void MALiquidSD::DefineCommands()
+{
+  fMessenger = new G4GenericMessenger(this, "/MA/hits/", "Hit control");
+
+  fMessenger->DeclareProperty("aggregate", fAggregate)
+    .SetGuidance("One hit per track over all sensitive volumes, summing the energy deposits,")
+    .SetGuidance("instead of one hit per step.")
+    .SetDefaultValue("true");
+
+  fMessenger->DeclareProperty("centroid", fCentroid)
+    .SetGuidance("Aggregated hits at the energy-weighted centroid of the steps")
+    .SetGuidance("instead of the first step position.")
+    .SetDefaultValue("true");
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+MALiquidHit* MALiquidSD::FindHit(G4int tid, G4bool& created)
+{
+  G4int& hit = fTable.Hit(tid);
+  created    = (hit < 0);
+  if(!created)
+    return (*fHitsCollection)[hit];
+
+  // new hit; caller fills it
+  MALiquidHit* newHit = new MALiquidHit();
+  hit                 = fHitsCollection->insert(newHit) - 1;
+  return newHit;
+}
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
@@ -34,6 +78,11 @@ void MALiquidSD::Initialize(G4HCofThisEvent* hce)
   G4int hcID 
     = G4SDManager::GetSDMpointer()->GetCollectionID(collectionName[0]);
   hce->AddHitsCollection( hcID, fHitsCollection ); 
+
+  // reset the aggregation table
+  fTable.Clear();
+  std::fill(fColumnDepth.begin(), fColumnDepth.end(), 0.);
+  fAggregateEvent = fAggregate || MARunAction::GetOutputLevel() != MAOutputLevel::full;
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -41,6 +90,17 @@ void MALiquidSD::Initialize(G4HCofThisEvent* hce)
 G4bool MALiquidSD::ProcessHits(G4Step* aStep, 
                                      G4TouchableHistory*)
 {  
+  // primary muon column depth, for the yield normalisation; replayed
+  // hall-entry neutrons and gammas are primaries as well
+  if (aStep->GetTrack()->GetParentID() == 0 &&
+      std::abs(aStep->GetTrack()->GetDefinition()->GetPDGEncoding()) == 13) {
+    G4int vcode = MAVolumeCodes::Get(
+      aStep->GetPreStepPoint()->GetPhysicalVolume()->GetLogicalVolume());
+    if (vcode >= 0)
+      fColumnDepth[vcode] += aStep->GetStepLength()
+        * aStep->GetPreStepPoint()->GetMaterial()->GetDensity() / (g/cm2);
+  }
+
   // energy deposit required
   G4double edep = aStep->GetTotalEnergyDeposit();
 
@@ -51,16 +111,44 @@ G4bool MALiquidSD::ProcessHits(G4Step* aStep,
   G4bool isTriton = aStep->GetTrack()->GetDefinition()->GetParticleName() == "triton";
   if (isGenIon || isTriton) {
 
+     // record mode: no tracking beyond this hit
+     if (MAStackingAction::StopAfterHit(aStep->GetTrack()))
+       aStep->GetTrack()->SetTrackStatus(fStopAndKill);
+
      // particle info on Ions
      auto iZ = aStep->GetTrack()->GetDefinition()->GetAtomicNumber();
      auto iA = aStep->GetTrack()->GetDefinition()->GetAtomicMass();
 
+     if (fAggregateEvent) {
+       G4bool created;
+       MALiquidHit* hit = FindHit(aStep->GetTrack()->GetTrackID(), created);
+
+       G4ThreeVector pos = aStep->GetPostStepPoint()->GetPosition();
+       if (created) {
+         // first step of this track in the sensitive volumes
+         hit->SetTID(aStep->GetTrack()->GetTrackID());
+         hit->SetIonZ(iZ);
+         hit->SetIonA(iA);
+         hit->SetVCode(MAVolumeCodes::Get(aStep->GetTrack()->GetLogicalVolumeAtVertex()));
+         hit->SetTime(aStep->GetTrack()->GetGlobalTime());
+         hit->SetEdep(edep);
+         hit->SetPos (pos);
+       }
+       else {
+         G4double etot = hit->GetEdep() + edep;
+         if (fCentroid)
+           hit->SetPos((hit->GetEdep() * hit->GetPos() + edep * pos) / etot);
+         hit->SetEdep(etot);
+       }
+       return true;
+     }
+
      MALiquidHit* newHit = new MALiquidHit();
 
      newHit->SetTID(aStep->GetTrack()->GetTrackID());
      newHit->SetIonZ(iZ);
      newHit->SetIonA(iA);
-     newHit->SetVName(aStep->GetTrack()->GetLogicalVolumeAtVertex()->GetName());
+     newHit->SetVCode(MAVolumeCodes::Get(aStep->GetTrack()->GetLogicalVolumeAtVertex()));
      newHit->SetTime(aStep->GetTrack()->GetGlobalTime());
      newHit->SetEdep(edep);
      newHit->SetPos (aStep->GetPostStepPoint()->GetPosition());
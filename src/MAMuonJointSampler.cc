@@ -0,0 +1,102 @@
+#include "MAMuonJointSampler.hh"
+#include "MAMuonSpectrum.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+
+namespace
+{
+  // integral of p0*(E/e0)^(expo-1) from e0 to e0*ratio
+  double PowerLawIntegral(double p0, double e0, double ratio, double expo)
+  {
+    if(std::abs(expo) < 1.0e-9)
+      return p0 * e0 * std::log(ratio);
+    return p0 * e0 * (std::pow(ratio, expo) - 1.0) / expo;
+  }
+}  // namespace
+
+MAMuonJointSampler::MAMuonJointSampler(const Config& cfg)
+: fConfig(cfg)
+{
+  int    nE   = std::max(1, cfg.energyBins);
+  int    nC   = std::max(1, cfg.cosThetaBins);
+  double lnE0 = std::log(lower_bound);
+  double dlnE = (std::log(upper_bound) - lnE0) / nE;
+  double dc   = (fullcosangle - nearhorizontal) / nC;
+
+  std::vector<double> energy(nE + 1);
+  for(int j = 0; j <= nE; ++j)
+    energy[j] = (j == nE) ? upper_bound : std::exp(lnE0 + j * dlnE);
+
+  MuAngle             angle(cfg.depth);
+  std::vector<double> weights;
+  std::vector<double> shape(nE + 1);
+  std::vector<double> rowInt(nE);
+  fCells.reserve(nE * nC);
+  weights.reserve(nE * nC);
+
+  for(int i = 0; i < nC; ++i)
+  {
+    double c0 = nearhorizontal + i * dc;
+    double c1 = (i == nC - 1) ? fullcosangle : c0 + dc;
+    double cm = 0.5 * (c0 + c1);
+    double a0 = angle(c0);
+    double a1 = angle(c1);
+    // Simpson rule for the angular weight of the row
+    double rowWeight = (a0 + 4.0 * angle(cm) + a1) * (c1 - c0) / 6.0;
+
+    // energy shape at the slant depth of the row centre
+    MuEnergy spectrum(cfg.slantDepth ? cfg.depth / cm : cfg.depth);
+    double   scale = spectrum.shape(lower_bound);
+    for(int j = 0; j <= nE; ++j)
+      shape[j] = spectrum.shape(energy[j]) / scale;
+
+    double rowTotal = 0.0;
+    for(int j = 0; j < nE; ++j)
+    {
+      double ratio = energy[j + 1] / energy[j];
+      double expo  = 1.0 - std::log(shape[j] / shape[j + 1]) / std::log(ratio);
+      rowInt[j]    = PowerLawIntegral(shape[j], energy[j], ratio, expo);
+      rowTotal += rowInt[j];
+      fCells.push_back({ c0, c1 - c0, a0, a1, energy[j], ratio, expo });
+    }
+    for(int j = 0; j < nE; ++j)
+      weights.push_back(rowWeight * rowInt[j] / rowTotal);
+  }
+  fAlias = MAAliasTable(weights);
+}
+
+void MAMuonJointSampler::Sample(double u1, double u2, double u3, double& energy,
+                                double& costheta) const
+{
+  const Cell& cell = fCells[fAlias.Sample(u1)];
+
+  // linear density in cos theta, same inversion as MASamplingTable
+  double slope = (cell.a1 - cell.a0) / cell.dc;
+  double rest  = u2 * 0.5 * (cell.a0 + cell.a1) * cell.dc;
+  double root  = std::sqrt(std::max(0.0, cell.a0 * cell.a0 + 2.0 * slope * rest));
+  double denom = cell.a0 + root;
+  double step  = (denom > 0.0) ? 2.0 * rest / denom : 0.0;
+  costheta     = cell.c0 + std::min(step, cell.dc);
+
+  // power law in energy
+  if(std::abs(cell.expo) < 1.0e-9)
+    energy = cell.e0 * std::pow(cell.ratio, u3);
+  else
+    energy = cell.e0 *
+             std::pow(1.0 + u3 * (std::pow(cell.ratio, cell.expo) - 1.0), 1.0 / cell.expo);
+}
+
+std::shared_ptr<const MAMuonJointSampler> MAMuonJointSampler::Get(const Config& cfg)
+{
+  static std::mutex                                cacheMutex;
+  static std::shared_ptr<const MAMuonJointSampler> cache;
+
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  if(!cache || !(cache->GetConfig() == cfg))
+  {
+    cache = std::make_shared<const MAMuonJointSampler>(cfg);
+  }
+  return cache;
+}
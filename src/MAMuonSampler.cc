@@ -0,0 +1,23 @@
+#include "MAMuonSampler.hh"
+#include "MAMuonSpectrum.hh"
+
+#include <mutex>
+
+MAMuonSampler::MAMuonSampler(double depth)
+: fDepth(depth)
+, fEnergy(nbins, lower_bound, upper_bound, MuEnergy(depth))
+, fCosTheta(nbins, nearhorizontal, fullcosangle, MuAngle(depth))
+{}
+
+std::shared_ptr<const MAMuonSampler> MAMuonSampler::Get(double depth)
+{
+  static std::mutex                           cacheMutex;
+  static std::shared_ptr<const MAMuonSampler> cache;
+
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  if(!cache || cache->GetDepth() != depth)
+  {
+    cache = std::make_shared<const MAMuonSampler>(depth);
+  }
+  return cache;
+}
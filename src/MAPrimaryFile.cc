@@ -0,0 +1,158 @@
+#include "MAPrimaryFile.hh"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <mutex>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+  const char magicTag[8] = { 'M', 'A', 'P', 'R', 'I', 'M', '0', '1' };
+}
+
+std::shared_ptr<MAPrimaryFileReader> MAPrimaryFileReader::Open(const std::string& name,
+                                                               std::string&       error)
+{
+  static std::mutex                                                 cacheMutex;
+  static std::map<std::string, std::weak_ptr<MAPrimaryFileReader>> cache;
+
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  if(auto reader = cache[name].lock())
+    return reader;
+
+  int fd = ::open(name.c_str(), O_RDONLY);
+  if(fd < 0)
+  {
+    error = "cannot open " + name;
+    return nullptr;
+  }
+  struct stat st;
+  if(::fstat(fd, &st) != 0 || st.st_size < (off_t) sizeof(MAPrimaryFileHeader))
+  {
+    ::close(fd);
+    error = name + " is too short for a primary file";
+    return nullptr;
+  }
+  void* map = ::mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);  // the mapping keeps the file
+  if(map == MAP_FAILED)
+  {
+    error = "cannot map " + name;
+    return nullptr;
+  }
+
+  std::shared_ptr<MAPrimaryFileReader> reader(new MAPrimaryFileReader);
+  reader->fName    = name;
+  reader->fMap     = map;
+  reader->fMapSize = st.st_size;
+
+  // entry count against the file size, without overflowing the product
+  const auto* header = static_cast<const MAPrimaryFileHeader*>(map);
+  std::uint64_t room =
+    (reader->fMapSize - sizeof(MAPrimaryFileHeader)) / sizeof(MAPrimaryRecord);
+  if(std::memcmp(header->magic, magicTag, sizeof(magicTag)) != 0 ||
+     header->recordSize != sizeof(MAPrimaryRecord) || header->entries > room)
+  {
+    error = name + " is not a valid primary file";
+    return nullptr;
+  }
+  reader->fEntries = header->entries;
+  reader->fRecords = reinterpret_cast<const MAPrimaryRecord*>(
+    static_cast<const char*>(map) + sizeof(MAPrimaryFileHeader));
+
+  // records are consumed front to back
+  ::madvise(map, reader->fMapSize, MADV_SEQUENTIAL);
+
+  cache[name] = reader;
+  return reader;
+}
+
+bool MAPrimaryFileReader::Claim(std::uint64_t& first, std::uint64_t& last,
+                                unsigned reuse)
+{
+  // every record has reuse consecutive slots; a slot on the first record
+  // of an event claims that event, the other slots are passed over
+  const std::uint64_t n = std::max(reuse, 1u);
+  while(true)
+  {
+    std::uint64_t i = fNext.fetch_add(1, std::memory_order_relaxed) / n;
+    if(i >= fEntries)
+      return false;
+    if(i > 0 && fRecords[i - 1].event == fRecords[i].event)
+      continue;
+
+    first = i;
+    last  = i + 1;
+    while(last < fEntries && fRecords[last].event == fRecords[first].event)
+      ++last;
+    return true;
+  }
+}
+
+MAPrimaryFileReader::~MAPrimaryFileReader()
+{
+  if(fMap != nullptr)
+    ::munmap(fMap, fMapSize);
+}
+
+bool MAPrimaryFileWriter::Open(const std::string& name)
+{
+  Close();
+  fFile = std::fopen(name.c_str(), "wb");
+  if(fFile == nullptr)
+    return false;
+
+  // placeholder header, entries filled in on Close()
+  MAPrimaryFileHeader header{};
+  std::memcpy(header.magic, magicTag, sizeof(magicTag));
+  header.recordSize = sizeof(MAPrimaryRecord);
+  fEntries          = 0;
+  fGood             = std::fwrite(&header, sizeof(header), 1, fFile) == 1;
+  return fGood;
+}
+
+bool MAPrimaryFileWriter::Write(const MAPrimaryRecord* records, std::size_t n)
+{
+  // a failed writer stays failed, its file is incomplete
+  if(fFile == nullptr || !fGood)
+    return false;
+  if(n > std::numeric_limits<std::uint64_t>::max() - fEntries)
+  {
+    fGood = false;
+    return false;
+  }
+  std::size_t written = std::fwrite(records, sizeof(MAPrimaryRecord), n, fFile);
+  fEntries += written;
+  fGood = (written == n);
+  return fGood;
+}
+
+bool MAPrimaryFileWriter::Flush()
+{
+  if(fFile == nullptr || !fGood)
+    return false;
+  MAPrimaryFileHeader header{};
+  std::memcpy(header.magic, magicTag, sizeof(magicTag));
+  header.entries    = fEntries;
+  header.recordSize = sizeof(MAPrimaryRecord);
+  fGood = std::fseek(fFile, 0, SEEK_SET) == 0 &&
+          std::fwrite(&header, sizeof(header), 1, fFile) == 1 &&
+          std::fseek(fFile, 0, SEEK_END) == 0 && std::fflush(fFile) == 0;
+  return fGood;
+}
+
+bool MAPrimaryFileWriter::Close()
+{
+  if(fFile == nullptr)
+    return false;
+  bool good = Flush();
+  good      = (std::fclose(fFile) == 0) && good;
+  fFile     = nullptr;
+  return good;
+}
@@ -4,28 +4,39 @@
 
 // geant
 #include "G4Event.hh"
+#include "G4IonTable.hh"
+#include "G4MuonMinus.hh"
+#include "G4MuonPlus.hh"
 #include "G4ParticleDefinition.hh"
 #include "G4ParticleGun.hh"
 #include "G4ParticleTable.hh"
 #include "G4PhysicalConstants.hh"
+#include "G4Run.hh"
+#include "G4RunManager.hh"
 #include "G4SystemOfUnits.hh"
 
-MAPrimaryGeneratorAction::MAPrimaryGeneratorAction(MADetectorConstruction* det)
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <vector>
+
+MAPrimaryGeneratorAction::MAPrimaryGeneratorAction(MADetectorConstruction* det,
+                                                   G4long                  seed)
 : G4VUserPrimaryGeneratorAction()
 , fDetector(det)
 , fParticleGun(nullptr)
 , fMessenger(nullptr)
+, fBundleMessenger(nullptr)
+, fSeed(seed)
 , fDepth(0.0)
 {
-  generator.seed(rd());  // set a random seed
-
   G4int nofParticles = 1;
   fParticleGun       = new G4ParticleGun(nofParticles);
 
-  auto particleTable = G4ParticleTable::GetParticleTable();
-
-  // default particle kinematics
-  fParticleGun->SetParticleDefinition(particleTable->FindParticle("mu-"));
+  // both charges, looked up once
+  fMuonMinus = G4MuonMinus::Definition();
+  fMuonPlus  = G4MuonPlus::Definition();
+  fParticleGun->SetParticleDefinition(fMuonMinus);
 
   // define commands for this class
   DefineCommands();
@@ -35,52 +46,371 @@ MAPrimaryGeneratorAction::~MAPrimaryGeneratorAction()
 {
   delete fParticleGun;
   delete fMessenger;
+  delete fBundleMessenger;
 }
 
-void MAPrimaryGeneratorAction::GeneratePrimaries(G4Event* event)
+MAPrimarySampler& MAPrimaryGeneratorAction::Core()
 {
-  using pld_type = std::piecewise_linear_distribution<double>;
+  MAPrimarySampler::Config cfg;
+  cfg.depth        = fDepth;
+  cfg.alias        = (fSamplerType == "alias");
+  cfg.energyBins   = fEnergyBins;
+  cfg.cosThetaBins = fCosThetaBins;
+  cfg.slantDepth   = fSlantDepth;
+  cfg.energyBias   = fEnergyBias;
+  cfg.biasIndex    = fBiasIndex;
+  cfg.radius       = fDetector->GetWorldExtent();
+  cfg.height       = fDetector->GetWorldSizeZ() - 1.0 * cm;  // top of world
 
-  int    nw             = 100;     // number of bins
-  double lower_bound    = 1.0;     // energy interval lower bound [GeV]
-  double upper_bound    = 3000.0;  // upper bound [GeV]
-  double nearhorizontal = 1.0e-5;
-  double fullcosangle   = 1.0;
+  // shared tables are looked up again only on a change of settings
+  if(!fCore || !(fCore->GetConfig() == cfg))
+  {
+    fCore = std::make_unique<MAPrimarySampler>(cfg);
+  }
+  return *fCore;
+}
 
-  // custom probability distributions
-  pld_type ed(nw, lower_bound, upper_bound, MuEnergy(fDepth));
-  pld_type cosd(nw, nearhorizontal, fullcosangle, MuAngle(fDepth));
+void MAPrimaryGeneratorAction::SampleEnergyAngle(G4double& ekin, G4double& costheta,
+                                                 G4double& weight)
+{
+  Core().SampleEnergyAngle(fEngine, ekin, costheta, weight);
+}
 
-  // momentum vector
-  G4double costheta = cosd(generator);  // get a random number
-  G4double sintheta = std::sqrt(1. - costheta * costheta);
+G4ThreeVector MAPrimaryGeneratorAction::SampleDirection(G4double costheta)
+{
+  G4double dir[3];
+  Core().SampleDirection(fEngine, costheta, dir);
+  return G4ThreeVector(dir[0], dir[1], dir[2]);
+}
 
-  std::uniform_real_distribution<> rndm(0.0, 1.0);   // azimuth angle
-  G4double phi    = CLHEP::twopi * rndm(generator);  // random uniform number
-  G4double sinphi = std::sin(phi);
-  G4double cosphi = std::cos(phi);
+void MAPrimaryGeneratorAction::WorldVertex(G4double& ekin, G4double& weight,
+                                           G4ThreeVector& dir, G4ThreeVector& pos)
+{
+  G4double costheta = 1.0;
+  SampleEnergyAngle(ekin, costheta, weight);
+  dir = SampleDirection(costheta);
 
-  G4double      px = -sintheta * cosphi;
-  G4double      py = -sintheta * sinphi;
-  G4double      pz = -costheta;  // default downwards: pz = -1.0
-  G4ThreeVector momentumDir(px, py, pz);
-  fParticleGun->SetParticleMomentumDirection(momentumDir);
-  // G4cout << "Momentum direction Primary: " << momentumDir << G4endl;
+  // position, top of world, sample circle uniformly
+  G4double vertex[3];
+  Core().SampleDisk(fEngine, vertex);
+  pos = G4ThreeVector(vertex[0], vertex[1], vertex[2]);
+}
 
-  G4double ekin = ed(generator);  // get random number
-  ekin *= GeV;
-  fParticleGun->SetParticleEnergy(ekin);
+void MAPrimaryGeneratorAction::TankVertex(G4double& ekin, G4double& weight,
+                                          G4ThreeVector& dir, G4ThreeVector& pos)
+{
+  // the projected area of the cryostat cube along dir is proportional
+  // to |dx|+|dy|+|dz| <= sqrt(3); accepting directions with that
+  // probability turns intensity into the rate through the cube
+  G4double      costheta = 1.0;
+  G4double      proj     = 0.0;
+  G4ThreeVector entry;
+  do
+  {
+    do
+    {
+      SampleEnergyAngle(ekin, costheta, weight);
+      dir  = SampleDirection(costheta);
+      proj = std::abs(dir.x()) + std::abs(dir.y()) + std::abs(dir.z());
+    } while(fEngine.Flat() * std::sqrt(3.0) > proj);
 
-  // position, top of world, sample circle uniformly
-  G4double zvertex = fDetector->GetWorldSizeZ();  // inline on MADetectorConstruction
-  G4double radius  = fDetector->GetWorldExtent() * rndm(generator);  // fraction of max
-  phi              = CLHEP::twopi * rndm(generator);  // another random angle
-  G4double vx      = radius * std::cos(phi);
-  G4double vy      = radius * std::sin(phi);
+    // entry face with probability proportional to its projected area,
+    // entry point uniform on that face
+    G4double h  = fDetector->GetTankHalfSide();
+    G4double u  = fEngine.Flat() * proj;
+    G4double s1 = h * (2.0 * fEngine.Flat() - 1.0);
+    G4double s2 = h * (2.0 * fEngine.Flat() - 1.0);
+
+    if(u < std::abs(dir.x()))
+      entry.set(-std::copysign(h, dir.x()), s1, s2);
+    else if(u < std::abs(dir.x()) + std::abs(dir.y()))
+      entry.set(s1, -std::copysign(h, dir.y()), s2);
+    else
+      entry.set(s1, s2, -std::copysign(h, dir.z()));
+    entry += fDetector->GetTankCentre();
+
+    // start where the line enters the cavern rock; resample the rare
+    // lines that do not cross it, e.g. grazing its edge
+  } while(!CavernEntry(entry, dir, pos));
+}
+
+G4bool MAPrimaryGeneratorAction::CavernEntry(const G4ThreeVector& point,
+                                             const G4ThreeVector& dir,
+                                             G4ThreeVector&       start) const
+{
+  // line point + s*dir against the cavern cylinder, slab by slab
+  G4double rc   = fDetector->GetWorldExtent();
+  G4double hc   = fDetector->GetCavernHalfHeight();
+  G4double smin = -DBL_MAX;
+  G4double smax = DBL_MAX;
 
-  fParticleGun->SetParticlePosition(G4ThreeVector(vx, vy, zvertex - 1.0 * cm));
+  if(dir.z() != 0.)
+  {
+    G4double s1 = (-hc - point.z()) / dir.z();
+    G4double s2 = (hc - point.z()) / dir.z();
+    smin        = std::min(s1, s2);
+    smax        = std::max(s1, s2);
+  }
+  else if(std::abs(point.z()) >= hc)
+    return false;
 
+  G4double a = dir.perp2();
+  G4double b = point.x() * dir.x() + point.y() * dir.y();
+  G4double c = point.perp2() - rc * rc;
+  if(a > 0.)
+  {
+    G4double disc = b * b - a * c;
+    if(disc <= 0.)
+      return false;
+    smin = std::max(smin, (-b - std::sqrt(disc)) / a);
+    smax = std::min(smax, (-b + std::sqrt(disc)) / a);
+  }
+  else if(c >= 0.)
+    return false;
+
+  if(smin >= smax)
+    return false;
+  start = point + (smin + std::min(1.0 * cm, 0.5 * (smax - smin))) * dir;
+  return true;
+}
+
+void MAPrimaryGeneratorAction::BuildBundleTables()
+{
+  // multiplicity m = 1..max, P(m) ~ m^-index
+  std::vector<G4double> weights;
+  for(G4int m = 1; m <= fBundle.maxMultiplicity; ++m)
+    weights.push_back(std::pow(m, -fBundle.index));
+  fMultiplicity = MAAliasTable(weights);
+
+  // distance to the bundle axis, dN/dR ~ R/(R+R0)^alpha
+  G4double r0    = fBundle.r0;
+  G4double alpha = fBundle.alpha;
+  fSeparation    = MASamplingTable(200, 0.0, fBundle.rmax, [r0, alpha](G4double r) {
+    return r / std::pow(r + r0, alpha);
+  });
+  fBundleBuilt = fBundle;
+}
+
+void MAPrimaryGeneratorAction::GenerateBundle(G4Event* event, const G4ThreeVector& dir,
+                                              const G4ThreeVector& axis)
+{
+  if(!(fBundleBuilt == fBundle))
+  {
+    BuildBundleTables();
+  }
+
+  // the first muon is on the axis and already generated
+  G4int multiplicity = fMultiplicity.Sample(fEngine.Flat()) + 1;
+
+  // frame perpendicular to the common direction
+  G4ThreeVector e1 = dir.orthogonal().unit();
+  G4ThreeVector e2 = dir.cross(e1);
+  for(G4int k = 1; k < multiplicity; ++k)
+  {
+    G4double      r     = fSeparation.Sample(fEngine.Flat());
+    G4double      phi   = CLHEP::twopi * fEngine.Flat();
+    G4ThreeVector point = axis + r * (std::cos(phi) * e1 + std::sin(phi) * e2);
+
+    // independent energy, parallel direction; only the energy of the
+    // sampled pair is used
+    G4double ekin     = 0.0;
+    G4double costheta = 1.0;
+    G4double weight   = 1.0;
+    SampleEnergyAngle(ekin, costheta, weight);
+
+    G4ThreeVector start;
+    if(!CavernEntry(point, dir, start))
+      continue;  // line misses the cavern
+
+    ShootMuon(event, ekin, weight, dir, start);
+  }
+}
+
+void MAPrimaryGeneratorAction::ShootMuon(G4Event* event, G4double ekin, G4double weight,
+                                         const G4ThreeVector& dir,
+                                         const G4ThreeVector& pos)
+{
+  // charge from the mu+/mu- ratio, or from the biased mu- fraction
+  // with a weight restoring the ratio
+  G4double natural = 1.0 / (1.0 + fChargeRatio);  // mu- fraction
+  G4double sampled = (fChargeBias > 0.0) ? fChargeBias : natural;
+  if(fEngine.Flat() < sampled)
+  {
+    fParticleGun->SetParticleDefinition(fMuonMinus);
+    weight *= natural / sampled;
+  }
+  else
+  {
+    fParticleGun->SetParticleDefinition(fMuonPlus);
+    weight *= (1.0 - natural) / (1.0 - sampled);
+  }
+  fEventWeight *= weight;
+
+  fParticleGun->SetParticleMomentumDirection(dir);
+  fParticleGun->SetParticleEnergy(ekin * GeV);
+  fParticleGun->SetParticlePosition(pos);
+  fParticleGun->SetParticleTime(0.0);
   fParticleGun->GeneratePrimaryVertex(event);
+
+  if(weight != 1.0)
+    event->GetPrimaryVertex(event->GetNumberOfPrimaryVertex() - 1)->SetWeight(weight);
+}
+
+void MAPrimaryGeneratorAction::ComputeNormalisation()
+{
+  // Simpson rule over the sampled cos(theta) range
+  const G4int    nsteps = 10000;  // even
+  const G4double cmin   = MAMuonSampler::nearhorizontal;
+  const G4double cmax   = MAMuonSampler::fullcosangle;
+  const G4double dc     = (cmax - cmin) / nsteps;
+
+  G4double h     = fDetector->GetTankHalfSide();
+  G4double rw    = fDetector->GetWorldExtent();
+  MuAngle  angle(fDepth);
+  G4double iint  = 0.0;  // integral of intensity
+  G4double aint  = 0.0;  // integral of intensity times projected area
+  for(G4int k = 0; k <= nsteps; ++k)
+  {
+    G4double c = cmin + k * dc;
+    G4double w = (k == 0 || k == nsteps) ? 1.0 : ((k % 2) ? 4.0 : 2.0);
+    G4double i = angle(c);
+    // phi averaged projected area of the cube, or the horizontal disk
+    G4double area = (fVertexMode == "tank")
+                      ? 4.0 * h * h * (4.0 / CLHEP::pi * std::sqrt(1.0 - c * c) + c)
+                      : CLHEP::pi * rw * rw;
+    iint += w * i;
+    aint += w * i * area;
+  }
+
+  fFlux       = CLHEP::twopi * iint * dc / 3.0;  // [1/(cm2 s)]
+  fGenArea    = aint / iint;                     // intensity weighted mean
+  fSolidAngle = CLHEP::twopi * (cmax - cmin);
+  fNormDepth  = fDepth;
+  fNormMode   = fVertexMode;
+}
+
+G4ParticleDefinition* MAPrimaryGeneratorAction::FindDefinition(G4int pdg)
+{
+  auto it = fDefinitions.find(pdg);
+  if(it != fDefinitions.end())
+    return it->second;
+
+  // nuclei by their 10LZZZAAAI code, everything else by PDG code
+  G4ParticleDefinition* def =
+    (std::abs(pdg) >= 1000000000)
+      ? G4IonTable::GetIonTable()->GetIon(pdg)
+      : G4ParticleTable::GetParticleTable()->FindParticle(pdg);
+  if(def == nullptr)
+  {
+    G4ExceptionDescription msg;
+    msg << "No particle definition for PDG code " << pdg;
+    G4Exception("MAPrimaryGeneratorAction::FindDefinition()", "MyCode0002",
+                FatalException, msg);
+  }
+  fDefinitions[pdg] = def;
+  return def;
+}
+
+void MAPrimaryGeneratorAction::GenerateFromFile(G4Event* event)
+{
+  if(!fFile || fFile->GetName() != fFileName)
+  {
+    std::string error;
+    fFile = MAPrimaryFileReader::Open(fFileName, error);
+    if(!fFile)
+    {
+      G4ExceptionDescription msg;
+      msg << "Primary file: " << error;
+      G4Exception("MAPrimaryGeneratorAction::GenerateFromFile()", "MyCode0003",
+                  FatalException, msg);
+      return;
+    }
+  }
+
+  std::uint64_t first = 0;
+  std::uint64_t last  = 0;
+  if(!fFile->Claim(first, last, fReuse))
+  {
+    // nothing left; finish the run with this empty event
+    G4ExceptionDescription msg;
+    msg << "Primary file " << fFileName << " exhausted after " << fFile->GetEntries()
+        << " entries, run aborted.";
+    G4Exception("MAPrimaryGeneratorAction::GenerateFromFile()", "MyCode0004",
+                JustWarning, msg);
+    G4RunManager::GetRunManager()->AbortRun(true);
+    event->SetEventAborted();
+    return;
+  }
+
+  // records are in internal units
+  for(std::uint64_t i = first; i < last; ++i)
+  {
+    const MAPrimaryRecord& record = (*fFile)[i];
+    fParticleGun->SetParticleDefinition(FindDefinition(record.pdg));
+    fParticleGun->SetParticleEnergy(record.ekin);
+    fParticleGun->SetParticlePosition(G4ThreeVector(record.x, record.y, record.z));
+    fParticleGun->SetParticleMomentumDirection(
+      G4ThreeVector(record.dx, record.dy, record.dz));
+    fParticleGun->SetParticleTime(record.time);
+    fParticleGun->GeneratePrimaryVertex(event);
+
+    G4double weight = record.weight / fReuse;
+    if(weight != 1.0)
+      event->GetPrimaryVertex(event->GetNumberOfPrimaryVertex() - 1)->SetWeight(weight);
+    if(i == first)
+      fEventWeight = weight;  // records of one event share its weight
+    else if(weight != fEventWeight && !fMixedWeights)
+    {
+      // maprimaries rejects these; files written elsewhere may not
+      fMixedWeights = true;
+      G4ExceptionDescription msg;
+      msg << "Primary file " << fFileName << ": records of event " << record.event
+          << " carry different weights, using the first, " << fEventWeight * fReuse
+          << ". Reported once.";
+      G4Exception("MAPrimaryGeneratorAction::GenerateFromFile()", "MyCode0012",
+                  JustWarning, msg);
+    }
+  }
+}
+
+void MAPrimaryGeneratorAction::GeneratePrimaries(G4Event* event)
+{
+  // independent stream per (run, event)
+  G4int runID = G4RunManager::GetRunManager()->GetCurrentRun()->GetRunID();
+  G4int evtID = event->GetEventID();
+  fEngine.Reset(static_cast<std::uint64_t>(fSeed),
+                (static_cast<std::uint64_t>(runID) << 32) | static_cast<std::uint32_t>(evtID));
+  fEventWeight = 1.0;
+
+  if(fSource == "file")
+  {
+    fGenArea = fFlux = 0.0;  // not known for external lists
+    fNormMode        = "";
+    GenerateFromFile(event);
+    return;
+  }
+
+  if(fNormDepth != fDepth || fNormMode != fVertexMode)
+  {
+    ComputeNormalisation();
+  }
+
+  G4double      ekin   = 0.0;  // [GeV]
+  G4double      weight = 1.0;
+  G4ThreeVector momentumDir;
+  G4ThreeVector position;
+  if(fVertexMode == "tank")
+    TankVertex(ekin, weight, momentumDir, position);
+  else
+    WorldVertex(ekin, weight, momentumDir, position);
+
+  ShootMuon(event, ekin, weight, momentumDir, position);
+
+  // further muons of a bundle, sharing the direction
+  if(fBundle.enable)
+  {
+    GenerateBundle(event, momentumDir, position);
+  }
 }
 
 void MAPrimaryGeneratorAction::DefineCommands()
@@ -95,4 +425,117 @@ void MAPrimaryGeneratorAction::DefineCommands()
   depthCmd.SetParameterName("d", true);
   depthCmd.SetRange("d>=0.");
   depthCmd.SetDefaultValue("0.");
+
+  // seed command
+  auto& seedCmd = fMessenger->DeclareProperty(
+    "seed", fSeed, "Master seed of the counter-based primary random stream.");
+  seedCmd.SetParameterName("s", false);
+  seedCmd.SetRange("s>=0");
+
+  // source commands
+  fMessenger->DeclareProperty("source", fSource)
+    .SetGuidance("Primary source: analytic muon spectrum or binary primary file.")
+    .SetCandidates("analytic file")
+    .SetDefaultValue("analytic");
+
+  fMessenger->DeclareProperty("file", fFileName)
+    .SetGuidance("Binary primary file for source file, see maprimaries.")
+    .SetParameterName("filename", false);
+
+  auto& reuseCmd = fMessenger->DeclareProperty(
+    "reuse", fReuse, "Replay every event of the primary file in n consecutive events.");
+  reuseCmd.SetParameterName("n", true);
+  reuseCmd.SetRange("n>=1");
+  reuseCmd.SetDefaultValue("1");
+
+  // charge commands
+  auto& ratioCmd = fMessenger->DeclareProperty("chargeRatio", fChargeRatio,
+                                               "Muon charge ratio N(mu+)/N(mu-).");
+  ratioCmd.SetParameterName("r", true);
+  ratioCmd.SetRange("r>=0.");
+  ratioCmd.SetDefaultValue("1.3");
+
+  auto& biasCmd = fMessenger->DeclareProperty(
+    "chargeBias", fChargeBias,
+    "Sampled mu- fraction, weights restore chargeRatio; 0 samples the ratio itself.");
+  biasCmd.SetParameterName("f", true);
+  biasCmd.SetRange("f>=0. && f<1.");
+  biasCmd.SetDefaultValue("0.");
+
+  // energy bias commands
+  fMessenger->DeclareProperty("energyBias", fEnergyBias)
+    .SetGuidance("Importance sample muon energies from E^-biasIndex, weighted to MuEnergy.")
+    .SetDefaultValue("true");
+
+  auto& biasIndexCmd = fMessenger->DeclareProperty(
+    "biasIndex", fBiasIndex, "Power law index of the biasing energy spectrum, 1 = flat in log E.");
+  biasIndexCmd.SetParameterName("g", true);
+  biasIndexCmd.SetRange("g>=0.");
+  biasIndexCmd.SetDefaultValue("1.");
+
+  // vertex command
+  fMessenger->DeclareProperty("vertex", fVertexMode)
+    .SetGuidance("Vertex generation: disk on top of the world, or rays through the "
+                 "cryostat sampled by projected area.")
+    .SetCandidates("world tank")
+    .SetDefaultValue("world");
+
+  // sampler commands
+  fMessenger->DeclareProperty("sampler", fSamplerType)
+    .SetGuidance("Energy-angle sampler: independent tables or joint alias method.")
+    .SetCandidates("table alias")
+    .SetDefaultValue("table");
+
+  auto& ebinsCmd = fMessenger->DeclareProperty(
+    "energyBins", fEnergyBins, "Number of log-spaced energy bins of the alias sampler.");
+  ebinsCmd.SetParameterName("n", true);
+  ebinsCmd.SetRange("n>0");
+  ebinsCmd.SetDefaultValue("200");
+
+  auto& cbinsCmd = fMessenger->DeclareProperty(
+    "cosThetaBins", fCosThetaBins, "Number of cos(theta) bins of the alias sampler.");
+  cbinsCmd.SetParameterName("n", true);
+  cbinsCmd.SetRange("n>0");
+  cbinsCmd.SetDefaultValue("100");
+
+  fMessenger->DeclareProperty("slantDepth", fSlantDepth)
+    .SetGuidance("Couple energy to zenith angle through the slant depth (alias sampler).")
+    .SetDefaultValue("true");
+
+  // bundle commands
+  fBundleMessenger =
+    new G4GenericMessenger(this, "/MA/generator/bundle/", "Muon bundle control");
+
+  fBundleMessenger->DeclareProperty("enable", fBundle.enable)
+    .SetGuidance("Generate muon bundles with sampled multiplicity and separation.")
+    .SetDefaultValue("true");
+
+  auto& indexCmd = fBundleMessenger->DeclareProperty(
+    "multiplicityIndex", fBundle.index, "Power law index of the multiplicity, P(m) ~ m^-index.");
+  indexCmd.SetParameterName("index", false);
+  indexCmd.SetRange("index>=0.");
+
+  auto& maxCmd = fBundleMessenger->DeclareProperty("maxMultiplicity",
+                                                   fBundle.maxMultiplicity,
+                                                   "Largest number of muons in a bundle.");
+  maxCmd.SetParameterName("m", false);
+  maxCmd.SetRange("m>=1");
+
+  fBundleMessenger
+    ->DeclarePropertyWithUnit("separationR0", "m", fBundle.r0,
+                              "Scale R0 of the distance to the bundle axis, "
+                              "dN/dR ~ R/(R+R0)^alpha.")
+    .SetParameterName("r0", false)
+    .SetRange("r0>0.");
+
+  fBundleMessenger
+    ->DeclareProperty("separationAlpha", fBundle.alpha,
+                      "Power alpha of the distance to the bundle axis.")
+    .SetParameterName("alpha", false);
+
+  fBundleMessenger
+    ->DeclarePropertyWithUnit("maxSeparation", "m", fBundle.rmax,
+                              "Largest distance to the bundle axis.")
+    .SetParameterName("rmax", false)
+    .SetRange("rmax>0.");
 }
@@ -0,0 +1,193 @@
+#include "MAPrimarySampler.hh"
+#include "MAVectorMath.hh"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+  const double twopi = 6.28318530717958647693;
+}
+
+void MAPrimaryBatch::resize(std::size_t n)
+{
+  for(auto* v : { &ekin, &dx, &dy, &dz, &x, &y, &z, &weight })
+    v->resize(n);
+}
+
+MAPrimarySampler::MAPrimarySampler(const Config& cfg)
+: fConfig(cfg)
+{
+  if(cfg.alias && !cfg.energyBias)
+  {
+    MAMuonJointSampler::Config joint;
+    joint.depth        = cfg.depth;
+    joint.energyBins   = cfg.energyBins;
+    joint.cosThetaBins = cfg.cosThetaBins;
+    joint.slantDepth   = cfg.slantDepth;
+    fJoint             = MAMuonJointSampler::Get(joint);
+  }
+  else
+  {
+    // tables are shared and built once per depth
+    fTables = MAMuonSampler::Get(cfg.depth);
+  }
+
+  if(cfg.energyBias)
+  {
+    double e0 = MAMuonSampler::lower_bound;
+    double e1 = MAMuonSampler::upper_bound;
+    double g  = cfg.biasIndex;
+    if(g == 1.0)
+    {
+      fBiasLow  = std::log(e0);
+      fBiasSpan = std::log(e1 / e0);
+      fBiasNorm = fBiasSpan;
+    }
+    else
+    {
+      fBiasLow  = std::pow(e0, 1.0 - g);
+      fBiasSpan = std::pow(e1, 1.0 - g) - fBiasLow;
+      fBiasNorm = fBiasSpan / (1.0 - g);
+    }
+  }
+}
+
+double MAPrimarySampler::BiasedEnergy(double u, double& weight) const
+{
+  double g      = fConfig.biasIndex;
+  double energy = (g == 1.0) ? std::exp(fBiasLow + u * fBiasSpan)
+                             : std::pow(fBiasLow + u * fBiasSpan, 1.0 / (1.0 - g));
+  double biased = std::pow(energy, -g) / fBiasNorm;
+  weight        = fTables->EnergyDensity(energy) / biased;
+  return energy;
+}
+
+void MAPrimarySampler::SampleEnergyAngle(MAPhiloxEngine& engine, double& ekin,
+                                         double& costheta, double& weight) const
+{
+  weight = 1.0;
+  if(fJoint)
+  {
+    double u1 = engine.Flat();
+    double u2 = engine.Flat();
+    double u3 = engine.Flat();
+    fJoint->Sample(u1, u2, u3, ekin, costheta);
+    return;
+  }
+  costheta = fTables->SampleCosTheta(engine.Flat());
+  ekin     = fConfig.energyBias ? BiasedEnergy(engine.Flat(), weight)
+                                : fTables->SampleEnergy(engine.Flat());
+}
+
+void MAPrimarySampler::SampleDirection(MAPhiloxEngine& engine, double costheta,
+                                       double dir[3]) const
+{
+  // momentum vector, default downwards
+  double sintheta = std::sqrt(1. - costheta * costheta);
+  double phi      = twopi * engine.Flat();
+  dir[0]          = -sintheta * std::cos(phi);
+  dir[1]          = -sintheta * std::sin(phi);
+  dir[2]          = -costheta;
+}
+
+void MAPrimarySampler::SampleDisk(MAPhiloxEngine& engine, double pos[3]) const
+{
+  // uniform in area
+  double radius = fConfig.radius * std::sqrt(engine.Flat());
+  double phi    = twopi * engine.Flat();
+  pos[0]        = radius * std::cos(phi);
+  pos[1]        = radius * std::sin(phi);
+  pos[2]        = fConfig.height;
+}
+
+void MAPrimarySampler::SampleScalar(MAPhiloxEngine& engine, MAPrimaryBatch& batch,
+                                    std::size_t n) const
+{
+  batch.resize(n);
+  for(std::size_t i = 0; i < n; ++i)
+  {
+    double costheta = 1.0;
+    double dir[3], pos[3];
+    SampleEnergyAngle(engine, batch.ekin[i], costheta, batch.weight[i]);
+    SampleDirection(engine, costheta, dir);
+    SampleDisk(engine, pos);
+    batch.dx[i] = dir[0];
+    batch.dy[i] = dir[1];
+    batch.dz[i] = dir[2];
+    batch.x[i]  = pos[0];
+    batch.y[i]  = pos[1];
+    batch.z[i]  = pos[2];
+  }
+}
+
+void MAPrimarySampler::SampleBatch(MAPhiloxEngine& engine, MAPrimaryBatch& batch,
+                                   std::size_t n)
+{
+  batch.resize(n);
+  fCos.resize(n);
+  fSin.resize(n);
+
+  // uniform numbers for all stages in one go
+  const std::size_t nea = fJoint ? 3 : 2;  // per energy-angle pair
+  fUniform.resize((nea + 3) * n);
+  engine.Flat(fUniform.data(), fUniform.size());
+  const double* u = fUniform.data();
+
+  // energy and cos theta into ekin and dz; table look-ups, not vectorised
+  double* ekin   = batch.ekin.data();
+  double* cz     = batch.dz.data();
+  double* weight = batch.weight.data();
+  std::fill(weight, weight + n, 1.0);
+  if(fJoint)
+  {
+    for(std::size_t i = 0; i < n; ++i)
+      fJoint->Sample(u[i], u[n + i], u[2 * n + i], ekin[i], cz[i]);
+  }
+  else
+  {
+    for(std::size_t i = 0; i < n; ++i)
+      cz[i] = fTables->SampleCosTheta(u[i]);
+    if(fConfig.energyBias)
+    {
+      for(std::size_t i = 0; i < n; ++i)
+        ekin[i] = BiasedEnergy(u[n + i], weight[i]);
+    }
+    else
+    {
+      for(std::size_t i = 0; i < n; ++i)
+        ekin[i] = fTables->SampleEnergy(u[n + i]);
+    }
+  }
+  u += nea * n;
+
+  // direction
+  double* dx = batch.dx.data();
+  double* dy = batch.dy.data();
+  double* s  = fSin.data();
+  double* c  = fCos.data();
+  MAVectorMath::SinCos2Pi(u, s, c, n);
+  for(std::size_t i = 0; i < n; ++i)
+  {
+    double sintheta = std::sqrt(std::max(0.0, 1. - cz[i] * cz[i]));
+    dx[i]           = -sintheta * c[i];
+    dy[i]           = -sintheta * s[i];
+    cz[i]           = -cz[i];
+  }
+  u += n;
+
+  // vertex on the disk
+  double*      x      = batch.x.data();
+  double*      y      = batch.y.data();
+  double*      z      = batch.z.data();
+  const double radius = fConfig.radius;
+  const double height = fConfig.height;
+  MAVectorMath::SinCos2Pi(u + n, s, c, n);
+  for(std::size_t i = 0; i < n; ++i)
+  {
+    double r = radius * std::sqrt(u[i]);
+    x[i]     = r * c[i];
+    y[i]     = r * s[i];
+    z[i]     = height;
+  }
+}
@@ -1,12 +1,27 @@
 #include "MARunAction.hh"
+#include "MANtupleLayout.hh"
+#include "MAPrimaryGeneratorAction.hh"
+#include "MAStackingAction.hh"
+#include "MASteppingAction.hh"
 #include "g4root.hh"
 
+#include <fstream>
+
+#include "G4AccumulableManager.hh"
 #include "G4Run.hh"
 #include "G4RunManager.hh"
 #include "G4SystemOfUnits.hh"
+#include "G4Threading.hh"
 #include "G4UnitsTable.hh"
 
-MARunAction::MARunAction(G4String name)
+namespace
+{
+  // set by the master between runs, read by all threads
+  MAOutputLevel outputLevel = MAOutputLevel::full;
+  G4bool        levelFixed  = false;  // ntuples booked
+}
+
+MARunAction::MARunAction(G4String name, const G4String& level)
 : G4UserRunAction()
 , fout(std::move(name))
 {
@@ -17,38 +32,121 @@ MARunAction::MARunAction(G4String name)
   analysisManager->SetVerboseLevel(1);
   analysisManager->SetNtupleMerging(true);
 
+  // isotope yields, filled by the event action
+  G4AccumulableManager::Instance()->RegisterAccumulable(&fYields);
+
+  // run termination and output level are global, one set of commands
+  if(G4Threading::IsMasterThread())
+  {
+    SetOutputLevel(level);
+    fMonitor = new MAConvergenceMonitor;
+    DefineCommands();
+  }
+}
+
+MARunAction::~MARunAction()
+{
+  delete fMonitor;
+  delete fMessenger;
+  delete G4AnalysisManager::Instance();
+}
+
+MAOutputLevel MARunAction::GetOutputLevel() { return outputLevel; }
+
+void MARunAction::SetOutputLevel(const G4String& level)
+{
+  if(levelFixed)
+  {
+    G4ExceptionDescription msg;
+    msg << "Output level is fixed once ntuples are booked, at the first run";
+    G4Exception("MARunAction::SetOutputLevel()", "MyCode0008", JustWarning, msg);
+    return;
+  }
+
+  if(level == "compact")
+    outputLevel = MAOutputLevel::compact;
+  else if(level == "summary")
+    outputLevel = MAOutputLevel::summary;
+  else
+    outputLevel = MAOutputLevel::full;
+}
+
+void MARunAction::DefineCommands()
+{
+  fMessenger = new G4GenericMessenger(this, "/MA/output/", "Output control");
+
+  fMessenger->DeclareMethod("level", &MARunAction::SetOutputLevel)
+    .SetGuidance("Output tier: full per-hit output; compact with aggregated hits,")
+    .SetGuidance("float columns and deduplicated ancestry; summary with yield")
+    .SetGuidance("tables and per-event scalars only. Fixed after the first run.")
+    .SetParameterName("level", false)
+    .SetCandidates("full compact summary")
+    .SetStates(G4State_PreInit, G4State_Idle)
+    .SetToBeBroadcasted(false);
+}
+
+void MARunAction::Book()
+{
+  // Get analysis manager
+  auto analysisManager = G4AnalysisManager::Instance();
+
   // Creating ntuple with value entries
   // since vector entries don't work anymore with 10.7
   //
-  analysisManager->CreateNtuple("Score", "Hits");
-  analysisManager->CreateNtupleIColumn("EventID");
-  analysisManager->CreateNtupleIColumn("HitID");
-  analysisManager->CreateNtupleIColumn("IonZ");
-  analysisManager->CreateNtupleIColumn("IonA");
-  analysisManager->CreateNtupleIColumn("VCode");
-  analysisManager->CreateNtupleDColumn("Edep");
-  analysisManager->CreateNtupleDColumn("Time");
-  analysisManager->CreateNtupleDColumn("Hitxloc");
-  analysisManager->CreateNtupleDColumn("Hityloc");
-  analysisManager->CreateNtupleDColumn("Hitzloc");
-  analysisManager->FinishNtuple();
-
-  analysisManager->CreateNtuple("Traj", "Trajectories");
-  analysisManager->CreateNtupleIColumn("EventID");
-  analysisManager->CreateNtupleIColumn("HitID");
-  analysisManager->CreateNtupleIColumn("ParentID");
-  analysisManager->CreateNtupleIColumn("Trjpdg");
-  analysisManager->CreateNtupleIColumn("VtxName");
-  analysisManager->CreateNtupleDColumn("TrjXVtx");
-  analysisManager->CreateNtupleDColumn("TrjYVtx");
-  analysisManager->CreateNtupleDColumn("TrjZVtx");
-  analysisManager->FinishNtuple();
-}
+  // all ntuples from the shared layout, real columns float unless full
+  G4bool full = (outputLevel == MAOutputLevel::full);
+  for(const auto& layout : MANtuple::layouts)
+  {
+    analysisManager->CreateNtuple(layout.name, layout.title);
+    for(std::size_t i = 0; i < layout.size; ++i)
+    {
+      const auto& column = layout.columns[i];
+      switch(column.type)
+      {
+        case 'I':
+          analysisManager->CreateNtupleIColumn(column.name);
+          break;
+        case 'S':
+          analysisManager->CreateNtupleSColumn(column.name);
+          break;
+        case 'R':
+          if(!full)
+          {
+            analysisManager->CreateNtupleFColumn(column.name);
+            break;
+          }
+          [[fallthrough]];
+        default:
+          analysisManager->CreateNtupleDColumn(column.name);
+      }
+    }
+    analysisManager->FinishNtuple();
+  }
+
+  // ntuples of the tier, the others are not written
+  G4bool summary = (outputLevel == MAOutputLevel::summary);
+  analysisManager->SetActivation(true);
+  analysisManager->SetNtupleActivation(MANtuple::kScore, !summary);
+  analysisManager->SetNtupleActivation(MANtuple::kTraj, full);
+  analysisManager->SetNtupleActivation(MANtuple::kNode, !summary);
+  analysisManager->SetNtupleActivation(MANtuple::kIso, !summary);
+  analysisManager->SetNtupleActivation(MANtuple::kEvent, !full);
 
-MARunAction::~MARunAction() { delete G4AnalysisManager::Instance(); }
+  fBooked = true;
+  if(IsMaster())
+    levelFixed = true;
+}
 
 void MARunAction::BeginOfRunAction(const G4Run* /*run*/)
 {
+  // ntuples booked once, for the output level of the first run
+  if(!fBooked)
+    Book();
+
+  G4AccumulableManager::Instance()->Reset();
+  if(IsMaster())
+    MAConvergenceMonitor::BeginOfRun();
+
   // Get analysis manager
   auto analysisManager = G4AnalysisManager::Instance();
 
@@ -62,6 +160,54 @@ void MARunAction::EndOfRunAction(const G4Run* /*run*/)
   // Get analysis manager
   auto analysisManager = G4AnalysisManager::Instance();
 
+  // generator normalisation from threads generating events
+  auto generator = dynamic_cast<const MAPrimaryGeneratorAction*>(
+    G4RunManager::GetRunManager()->GetUserPrimaryGeneratorAction());
+  // counted by the event action, so without aborted events, e.g. those of
+  // an exhausted primary file, which G4Run::GetNumberOfEvent() includes
+  G4int nofEvents = fYields.GetEvents();
+  if(generator != nullptr && nofEvents > 0)
+  {
+    G4double area     = generator->GetGenerationArea();
+    G4double flux     = generator->GetIntegratedFlux();
+    G4double livetime = (flux * area > 0.) ? nofEvents / (flux * area / cm2) : 0.;
+
+    using namespace MANtuple;
+    analysisManager->FillNtupleIColumn(kNorm, Norm::NEvents, nofEvents);
+    analysisManager->FillNtupleDColumn(kNorm, Norm::Depth, generator->GetDepth());
+    analysisManager->FillNtupleDColumn(kNorm, Norm::Area, area / m2);
+    analysisManager->FillNtupleDColumn(kNorm, Norm::SolidAngle, generator->GetSolidAngle());
+    analysisManager->FillNtupleDColumn(kNorm, Norm::Flux, flux);
+    analysisManager->FillNtupleDColumn(kNorm, Norm::LiveTime, livetime);
+    analysisManager->AddNtupleRow(kNorm);
+
+    G4cout << "--- Generator normalisation: " << nofEvents << " events, area "
+           << area / m2 << " m2 x solid angle " << generator->GetSolidAngle()
+           << " sr, live time " << livetime << " s" << G4endl;
+  }
+
+  // convergence totals complete once all threads are here
+  MAConvergenceMonitor::EndOfRun(IsMaster());
+
+  // isotope yields merged from all threads, to screen and file
+  G4AccumulableManager::Instance()->Merge();
+  if(IsMaster() && fYields.GetPrimaries() > 0.)
+  {
+    fYields.Print(G4cout);
+
+    G4String name = fout;
+    if(name.size() > 5 && name.substr(name.size() - 5) == ".root")
+      name.erase(name.size() - 5);
+    std::ofstream table(name + "_yields.txt");
+    fYields.Print(table);
+  }
+
+  // stacking rule counts from all threads
+  MAStackingAction::EndOfRun(IsMaster());
+
+  // phase-space records of this thread to file, if recording
+  MASteppingAction::EndOfRun(IsMaster());
+
   // save ntuple
   //
   analysisManager->Write();
@@ -0,0 +1,45 @@
+#include "MASamplingTable.hh"
+
+#include <algorithm>
+#include <cmath>
+
+void MASamplingTable::BuildCDF()
+{
+  // trapezoidal integral, exact for a piecewise linear density
+  fCdf.assign(fX.size(), 0.0);
+  for(std::size_t i = 1; i < fX.size(); ++i)
+  {
+    fCdf[i] = fCdf[i - 1] + 0.5 * (fPdf[i - 1] + fPdf[i]) * (fX[i] - fX[i - 1]);
+  }
+}
+
+double MASamplingTable::Sample(double u) const
+{
+  double target = u * fCdf.back();
+
+  // interval i with fCdf[i] <= target < fCdf[i+1]
+  auto        it = std::upper_bound(fCdf.begin() + 1, fCdf.end() - 1, target);
+  std::size_t i  = (it - fCdf.begin()) - 1;
+
+  // invert the quadratic cumulative inside the interval,
+  // written to stay stable for a vanishing slope
+  double dx    = fX[i + 1] - fX[i];
+  double slope = (fPdf[i + 1] - fPdf[i]) / dx;
+  double rest  = target - fCdf[i];
+  double root  = std::sqrt(std::max(0.0, fPdf[i] * fPdf[i] + 2.0 * slope * rest));
+  double denom = fPdf[i] + root;
+  double step  = (denom > 0.0) ? 2.0 * rest / denom : 0.0;
+
+  return fX[i] + std::min(step, dx);
+}
+
+double MASamplingTable::Density(double x) const
+{
+  if(x < fX.front() || x > fX.back())
+    return 0.0;
+
+  auto        it = std::upper_bound(fX.begin() + 1, fX.end() - 1, x);
+  std::size_t i  = (it - fX.begin()) - 1;
+  double      t  = (x - fX[i]) / (fX[i + 1] - fX[i]);
+  return ((1.0 - t) * fPdf[i] + t * fPdf[i + 1]) / fCdf.back();
+}
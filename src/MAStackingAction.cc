@@ -1,12 +1,444 @@
 #include "MAStackingAction.hh"
+#include "MADetectorConstruction.hh"
+#include "MALiquidSD.hh"
+#include "MAVolumeCodes.hh"
+
+#include "G4AutoLock.hh"
+#include "G4Electron.hh"
+#include "G4Gamma.hh"
+#include "G4Ions.hh"
+#include "G4ParticleDefinition.hh"
+#include "G4ParticleTable.hh"
+#include "G4Positron.hh"
+#include "G4RunManager.hh"
+#include "G4SDManager.hh"
+#include "G4StackManager.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4VPhysicalVolume.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+namespace
+{
+  // rule and stage counts over all threads, by rule
+  G4Mutex               countsMutex = G4MUTEX_INITIALIZER;
+  G4double              stagesKept    = 0.;
+  G4double              stagesDropped = 0.;
+  G4double              ionsKilled    = 0.;
+  G4double              ionsStopped   = 0.;
+  G4double              ionsKept      = 0.;
+  std::vector<G4String> ruleTexts;
+  std::vector<G4double> ruleCounts;
+  std::vector<G4double> ruleEnergy;
+
+  G4ThreadLocal MAStackingAction* threadInstance = nullptr;
+}
+
+MAStackingAction::MAStackingAction()
+: G4UserStackingAction()
+{
+  threadInstance = this;
+  DefineCommands();
+}
+
+MAStackingAction::~MAStackingAction()
+{
+  if(threadInstance == this)
+    threadInstance = nullptr;
+  delete fMessenger;
+}
 
 G4ClassificationOfNewTrack MAStackingAction ::ClassifyNewTrack(const G4Track* aTrack)
 {
   G4ClassificationOfNewTrack classification = fUrgent;
 
+  // waiting tracks reclassified by NewStage(): only the deferred EM go
+  if(fDropping)
+    return (IsStagedEM(aTrack) && (fRules.empty() || MatchRule(aTrack) < 0)) ? fKill
+                                                                             : fUrgent;
+
+  // only Ion production of interest
+  const G4ParticleDefinition* def  = aTrack->GetDefinition();
+  G4bool                      ion  = def->IsGeneralIon() || def->GetParticleName() == "triton";
+  G4bool                      kept = ion && IsKept(def->GetAtomicNumber(), def->GetAtomicMass());
+  if(fRecord && ion)
+  {
+    MAIsotope iso;
+    iso.tid        = aTrack->GetTrackID();
+    iso.Z          = def->GetAtomicNumber();
+    iso.A          = def->GetAtomicMass();
+    // vertex volume is only set once tracking starts; secondaries carry
+    // the touchable of their creation point, primaries none
+    const G4VPhysicalVolume* pv = aTrack->GetVolume();
+    iso.vcode      = (pv != nullptr) ? MAVolumeCodes::Get(pv->GetLogicalVolume()) : -1;
+    iso.excitation = static_cast<const G4Ions*>(def)->GetExcitationEnergy();
+    iso.time       = aTrack->GetGlobalTime();
+    iso.vertex     = aTrack->GetPosition();
+    iso.creator    = aTrack->GetCreatorProcess();
+    fIsotopes.push_back(iso);
+
+    // nuclei on the keep-list are tracked with their decay chains
+    if(fIonMode != "track" && kept)
+    {
+      fIonsKept += 1.;
+    }
+    else if(fIonMode == "kill")
+    {
+      fIonsKilled += 1.;
+      return fKill;
+    }
+    else if(fIonMode == "wait")
+    {
+      return fWaiting;
+    }
+    else if(fIonMode == "record" &&
+            (!MAVolumeCodes::IsSensitive(iso.vcode) || aTrack->GetKineticEnergy() <= 0.))
+    {
+      // no hit to come; the others are stopped by MALiquidSD after theirs
+      fIonsKilled += 1.;
+      return fKill;
+    }
+  }
+
+  // kill policy, never for primaries; the keep-list takes precedence
+  if(!fRules.empty() && aTrack->GetParentID() > 0 && !kept)
+    classification = ApplyRules(aTrack);
+
+  // first stage: defer low-energy EM secondaries
+  if(fStaged && fStage == 0 && classification == fUrgent && IsStagedEM(aTrack))
+    classification = fWaiting;
+
   return classification;
 }
 
-void MAStackingAction::NewStage() { ; }
+G4bool MAStackingAction::IsStagedEM(const G4Track* aTrack) const
+{
+  const G4ParticleDefinition* def = aTrack->GetDefinition();
+  return aTrack->GetParentID() > 0 && aTrack->GetKineticEnergy() < fEMThreshold &&
+         (def == G4Electron::Definition() || def == G4Gamma::Definition() ||
+          def == G4Positron::Definition());
+}
+
+G4bool MAStackingAction::StopAfterHit(const G4Track* aTrack)
+{
+  MAStackingAction* self = threadInstance;
+  if(self == nullptr || !self->fRecord || self->fIonMode != "record")
+    return false;
 
-void MAStackingAction::PrepareNewEvent() { ; }
+  const G4ParticleDefinition* def = aTrack->GetDefinition();
+  if(self->IsKept(def->GetAtomicNumber(), def->GetAtomicMass()))
+    return false;
+  self->fIonsStopped += 1.;
+  return true;
+}
+
+G4bool MAStackingAction::IsKept(G4int Z, G4int A) const
+{
+  return std::find(fKeep.begin(), fKeep.end(), std::make_pair(Z, A)) != fKeep.end();
+}
+
+G4ClassificationOfNewTrack MAStackingAction::ApplyRules(const G4Track* aTrack)
+{
+  G4int r = MatchRule(aTrack);
+  if(r < 0)
+    return fUrgent;
+
+  fCounts[r] += 1.;
+  fEnergy[r] += aTrack->GetKineticEnergy();
+  return fRules[r].action;
+}
+
+G4int MAStackingAction::MatchRule(const G4Track* aTrack) const
+{
+  G4int id  = aTrack->GetDefinition()->GetParticleDefinitionID();
+  G4int row = (id >= 0 && id < fRows - 1) ? id : fRows - 1;
+
+  const G4VPhysicalVolume* pv    = aTrack->GetVolume();
+  G4int                    vcode = (pv != nullptr) ? MAVolumeCodes::Get(pv->GetLogicalVolume()) : -1;
+
+  const Cell& cell = fCells[row * (MAVolumeCodes::kNumCodes + 1) + vcode + 1];
+  if(cell.begin == cell.end)
+    return -1;
+
+  // distance to the cryostat cube, 0 inside
+  G4ThreeVector d = aTrack->GetPosition() - fTankCentre;
+  G4double      dx = std::max(std::abs(d.x()) - fTankHalfSide, 0.);
+  G4double      dy = std::max(std::abs(d.y()) - fTankHalfSide, 0.);
+  G4double      dz = std::max(std::abs(d.z()) - fTankHalfSide, 0.);
+  G4double      distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+
+  G4double ekin = aTrack->GetKineticEnergy();
+  for(G4int i = cell.begin; i < cell.end; ++i)
+  {
+    G4int       r    = fCellRules[i];
+    const Rule& rule = fRules[r];
+    if(ekin < rule.emax && distance > rule.dmin)
+      return r;
+  }
+  return -1;
+}
+
+void MAStackingAction::NewStage()
+{
+  if(!fStaged || fStage++ > 0)
+    return;
+
+  // candidate activity in the sensitive volumes so far
+  auto sd = static_cast<const MALiquidSD*>(
+    G4SDManager::GetSDMpointer()->FindSensitiveDetector("LiquidSD", false));
+  G4bool active = (sd != nullptr && sd->GetNumberOfHits() > 0);
+  for(std::size_t i = 0; i < fIsotopes.size() && !active; ++i)
+    active = MAVolumeCodes::IsSensitive(fIsotopes[i].vcode);
+
+  // the waiting EM showers only matter next to argon activity; the stage
+  // also holds waiting ions and rule deferrals, which are tracked anyway
+  if(active)
+  {
+    fKept += 1.;
+  }
+  else
+  {
+    fDropped += 1.;
+    fDropping = true;
+    stackManager->ReClassify();
+    fDropping = false;
+  }
+}
+
+void MAStackingAction::PrepareNewEvent()
+{
+  fIsotopes.clear();
+  fStage = 0;
+  if(fDirty)
+    CompileRules();
+}
+
+void MAStackingAction::CompileRules()
+{
+  fDirty = false;
+
+  // cryostat, for the distance condition
+  auto det = dynamic_cast<const MADetectorConstruction*>(
+    G4RunManager::GetRunManager()->GetUserDetectorConstruction());
+  if(det != nullptr)
+  {
+    fTankCentre   = det->GetTankCentre();
+    fTankHalfSide = det->GetTankHalfSide();
+  }
+
+  auto* table = G4ParticleTable::GetParticleTable();
+  for(auto& rule : fRules)
+  {
+    rule.def = (rule.particle == "all") ? nullptr : table->FindParticle(rule.particle);
+    if(rule.particle != "all" && rule.def == nullptr)
+    {
+      G4ExceptionDescription msg;
+      msg << "Unknown particle in stacking rule '" << rule.text << "', rule ignored";
+      G4Exception("MAStackingAction::CompileRules()", "MyCode0009", JustWarning, msg);
+    }
+  }
+
+  // last row for particles without an ID when compiling, e.g. new ions
+  fRows        = table->entries() + 1;
+  G4int nslots = MAVolumeCodes::kNumCodes + 1;
+  fCells.assign(fRows * nslots, Cell());
+  fCellRules.clear();
+  for(G4int row = 0; row < fRows; ++row)
+  {
+    for(G4int slot = 0; slot < nslots; ++slot)
+    {
+      Cell& cell = fCells[row * nslots + slot];
+      cell.begin = fCellRules.size();
+      for(std::size_t r = 0; r < fRules.size(); ++r)
+      {
+        const Rule& rule = fRules[r];
+        G4bool      particle =
+          (rule.particle == "all") ||
+          (rule.def != nullptr && rule.def->GetParticleDefinitionID() == row);
+        G4bool volume = (rule.vcode == -2 || rule.vcode == slot - 1);
+        if(particle && volume)
+          fCellRules.push_back(r);
+      }
+      cell.end = fCellRules.size();
+    }
+  }
+}
+
+void MAStackingAction::EndOfRun(G4bool master)
+{
+  G4AutoLock lock(&countsMutex);
+
+  // this thread's counts, also the only thread in sequential mode
+  MAStackingAction* self = threadInstance;
+  if(self != nullptr && !self->fRules.empty())
+  {
+    if(ruleTexts.size() < self->fRules.size())
+    {
+      ruleTexts.resize(self->fRules.size());
+      ruleCounts.resize(self->fRules.size(), 0.);
+      ruleEnergy.resize(self->fRules.size(), 0.);
+    }
+    for(std::size_t r = 0; r < self->fRules.size(); ++r)
+    {
+      ruleTexts[r] = self->fRules[r].text;
+      ruleCounts[r] += self->fCounts[r];
+      ruleEnergy[r] += self->fEnergy[r];
+    }
+    std::fill(self->fCounts.begin(), self->fCounts.end(), 0.);
+    std::fill(self->fEnergy.begin(), self->fEnergy.end(), 0.);
+  }
+
+  if(self != nullptr)
+  {
+    stagesKept += self->fKept;
+    stagesDropped += self->fDropped;
+    self->fKept    = 0.;
+    self->fDropped = 0.;
+    ionsKilled += self->fIonsKilled;
+    ionsStopped += self->fIonsStopped;
+    ionsKept += self->fIonsKept;
+    self->fIonsKilled  = 0.;
+    self->fIonsStopped = 0.;
+    self->fIonsKept    = 0.;
+  }
+
+  if(!master)
+    return;
+
+  if(ionsKilled + ionsStopped + ionsKept > 0.)
+  {
+    G4cout << "--- Ion fates: " << ionsKilled << " nuclei killed at creation, "
+           << ionsStopped << " stopped after their hit, " << ionsKept
+           << " kept for their decay chain" << G4endl;
+  }
+  ionsKilled  = 0.;
+  ionsStopped = 0.;
+  ionsKept    = 0.;
+
+  if(stagesKept + stagesDropped > 0.)
+  {
+    G4cout << "--- Staged stacking: waiting EM stage kept in " << stagesKept
+           << " events, dropped in " << stagesDropped << G4endl;
+  }
+  stagesKept    = 0.;
+  stagesDropped = 0.;
+
+  if(ruleTexts.empty())
+    return;
+
+  G4cout << "--- Stacking rules: tracks killed or deferred" << G4endl;
+  for(std::size_t r = 0; r < ruleTexts.size(); ++r)
+  {
+    G4cout << "    " << r << " [" << ruleTexts[r] << "]: " << ruleCounts[r]
+           << " tracks, " << ruleEnergy[r] / MeV << " MeV" << G4endl;
+  }
+  ruleTexts.clear();
+  ruleCounts.clear();
+  ruleEnergy.clear();
+}
+
+void MAStackingAction::AddRule(const G4String& text)
+{
+  // particle volume action emax[MeV] dmin[m]
+  std::istringstream is(text);
+  Rule               rule;
+  G4String           volume, action;
+  G4double           emax, dmin;
+  G4bool             ok = (is >> rule.particle >> volume >> action >> emax >> dmin) &&
+              (action == "kill" || action == "wait");
+  if(ok && volume != "all")
+  {
+    std::istringstream vs(volume);
+    ok = (vs >> rule.vcode) && rule.vcode >= -1 && rule.vcode < MAVolumeCodes::kNumCodes;
+  }
+  if(!ok)
+  {
+    G4ExceptionDescription msg;
+    msg << "Bad stacking rule '" << text << "', expect particle VCode|all kill|wait "
+        << "Emax[MeV] Dmin[m]";
+    G4Exception("MAStackingAction::AddRule()", "MyCode0009", JustWarning, msg);
+    return;
+  }
+  rule.text   = text;
+  rule.action = (action == "kill") ? fKill : fWaiting;
+  rule.emax   = emax * MeV;
+  rule.dmin   = dmin * m;
+  fRules.push_back(rule);
+  fCounts.push_back(0.);
+  fEnergy.push_back(0.);
+  fDirty = true;
+}
+
+void MAStackingAction::ClearRules()
+{
+  fRules.clear();
+  fCounts.clear();
+  fEnergy.clear();
+  fDirty = true;
+}
+
+void MAStackingAction::AddKeep(const G4String& isotope)
+{
+  std::istringstream is(isotope);
+  G4int              Z, A;
+  if(!(is >> Z >> A) || Z < 0 || A < Z)
+  {
+    G4ExceptionDescription msg;
+    msg << "Bad keep-list isotope '" << isotope << "', expect Z A";
+    G4Exception("MAStackingAction::AddKeep()", "MyCode0011", JustWarning, msg);
+    return;
+  }
+  if(!IsKept(Z, A))
+    fKeep.emplace_back(Z, A);
+}
+
+void MAStackingAction::ClearKeep() { fKeep.clear(); }
+
+void MAStackingAction::DefineCommands()
+{
+  fMessenger = new G4GenericMessenger(this, "/MA/stacking/", "Stacking control");
+
+  fMessenger->DeclareProperty("isotopes", fRecord)
+    .SetGuidance("Record every new nucleus at creation to the Iso ntuple.")
+    .SetDefaultValue("true");
+
+  fMessenger->DeclareProperty("ion", fIonMode)
+    .SetGuidance("Fate of recorded nuclei: track them, postpone them to the")
+    .SetGuidance("waiting stack, or kill them when decay products are not needed.")
+    .SetGuidance("record: kill them after their hit in the sensitive volumes,")
+    .SetGuidance("or at creation elsewhere, without tracking their decays.")
+    .SetCandidates("track wait kill record")
+    .SetDefaultValue("track");
+
+  fMessenger->DeclareMethod("keep", &MAStackingAction::AddKeep)
+    .SetGuidance("Always track this isotope and its decay chain: Z A,")
+    .SetGuidance("e.g. 18 39 for Ar-39 or 17 36 for Cl-36.")
+    .SetParameterName("isotope", false);
+
+  fMessenger->DeclareMethod("clearKeep", &MAStackingAction::ClearKeep)
+    .SetGuidance("Remove all isotopes from the keep-list.");
+
+  fMessenger->DeclareMethod("rule", &MAStackingAction::AddRule)
+    .SetGuidance("Kill or defer secondaries: particle VCode action Emax Dmin")
+    .SetGuidance("particle: name or all; VCode: creation volume code or all;")
+    .SetGuidance("action: kill or wait; applies below Emax [MeV] and beyond")
+    .SetGuidance("Dmin [m] from the cryostat. The first matching rule applies.")
+    .SetParameterName("rule", false);
+
+  fMessenger->DeclareMethod("clearRules", &MAStackingAction::ClearRules)
+    .SetGuidance("Remove all stacking rules.");
+
+  fMessenger->DeclareProperty("staged", fStaged)
+    .SetGuidance("Track hadrons and ions first; low-energy EM secondaries wait and")
+    .SetGuidance("are only tracked if the event has activity in the sensitive volumes.")
+    .SetDefaultValue("true");
+
+  auto& thresholdCmd =
+    fMessenger->DeclarePropertyWithUnit("emThreshold", "MeV", fEMThreshold,
+                                        "Kinetic energy below which EM secondaries wait");
+  thresholdCmd.SetParameterName("E", true);
+  thresholdCmd.SetRange("E>=0.");
+  thresholdCmd.SetDefaultValue("100.");
+}
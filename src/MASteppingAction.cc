@@ -0,0 +1,127 @@
+#include "MASteppingAction.hh"
+
+#include "G4AutoLock.hh"
+#include "G4Event.hh"
+#include "G4EventManager.hh"
+#include "G4PhysicalVolumeStore.hh"
+#include "G4Step.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4Track.hh"
+
+namespace
+{
+  G4Mutex             fileMutex = G4MUTEX_INITIALIZER;
+  MAPrimaryFileWriter fileWriter;
+  std::uint32_t       fileEvents = 0;  // events written so far
+
+  G4ThreadLocal MASteppingAction* threadInstance = nullptr;
+
+  // flush once this many records are buffered, at an event boundary
+  const std::size_t chunk = 4096;
+
+  // a short write leaves records the header may not match
+  void WriteError()
+  {
+    G4ExceptionDescription msg;
+    msg << "Cannot write phase-space file, e.g. disk full; the file is incomplete";
+    G4Exception("MASteppingAction::Flush()", "MyCode0006", FatalException, msg);
+  }
+}
+
+MASteppingAction::MASteppingAction(const G4String& filename)
+: G4UserSteppingAction()
+{
+  fBuffer.reserve(chunk);
+  threadInstance = this;
+
+  G4AutoLock lock(&fileMutex);
+  if(!fileWriter.IsOpen() && !fileWriter.Open(filename))
+  {
+    G4ExceptionDescription msg;
+    msg << "Cannot create phase-space file " << filename;
+    G4Exception("MASteppingAction::MASteppingAction()", "MyCode0006", FatalException,
+                msg);
+  }
+}
+
+MASteppingAction::~MASteppingAction()
+{
+  Flush();
+  if(threadInstance == this)
+    threadInstance = nullptr;
+}
+
+void MASteppingAction::UserSteppingAction(const G4Step* step)
+{
+  // boundary volumes, looked up once geometry exists
+  if(fHall == nullptr)
+  {
+    auto* store = G4PhysicalVolumeStore::GetInstance();
+    fCavern     = store->GetVolume("Cavern_phys");
+    fHall       = store->GetVolume("Hall_phys");
+  }
+
+  const G4StepPoint* post = step->GetPostStepPoint();
+  if(post->GetStepStatus() != fGeomBoundary ||
+     post->GetPhysicalVolume() != fHall ||
+     step->GetPreStepPoint()->GetPhysicalVolume() != fCavern)
+    return;
+
+  G4Track* track = step->GetTrack();
+  G4int    pdg   = track->GetDefinition()->GetPDGEncoding();
+  auto     event = static_cast<std::uint32_t>(
+    G4EventManager::GetEventManager()->GetConstCurrentEvent()->GetEventID());
+
+  // never split an event across flushes
+  if(fBuffer.size() >= chunk && fBuffer.back().event != event)
+    Flush();
+
+  if(pdg != 0)  // no PDG code, cannot be replayed
+  {
+    const G4ThreeVector& pos = post->GetPosition();
+    const G4ThreeVector& dir = post->GetMomentumDirection();
+    fBuffer.push_back({ pdg, float(post->GetKineticEnergy()), float(pos.x()),
+                        float(pos.y()), float(pos.z()), float(dir.x()), float(dir.y()),
+                        float(dir.z()), float(post->GetGlobalTime()),
+                        float(track->GetWeight()), event });
+  }
+  track->SetTrackStatus(fStopAndKill);
+}
+
+void MASteppingAction::Flush()
+{
+  if(fBuffer.empty())
+    return;
+
+  G4AutoLock lock(&fileMutex);
+
+  // renumber thread-local event IDs into consecutive file events
+  std::uint32_t label = fBuffer.front().event;
+  std::uint32_t event = fileEvents;
+  for(auto& record : fBuffer)
+  {
+    if(record.event != label)
+    {
+      label = record.event;
+      ++event;
+    }
+    record.event = event;
+  }
+  fileEvents = event + 1;
+
+  if(!fileWriter.Write(fBuffer.data(), fBuffer.size()))
+    WriteError();
+  fBuffer.clear();
+}
+
+void MASteppingAction::EndOfRun(G4bool master)
+{
+  if(threadInstance != nullptr)
+    threadInstance->Flush();
+  if(master)
+  {
+    G4AutoLock lock(&fileMutex);
+    if(!fileWriter.Flush())
+      WriteError();
+  }
+}
@@ -0,0 +1,31 @@
+#include "MATrackHistory.hh"
+#include "MAVolumeCodes.hh"
+
+#include "G4ParticleDefinition.hh"
+#include "G4Track.hh"
+
+void MATrackHistory::Clear()
+{
+  for(auto* v : { &fTrackID, &fParentID, &fPDG, &fVertexCode })
+    v->clear();
+  for(auto* v : { &fX, &fY, &fZ })
+    v->clear();
+}
+
+void MATrackHistory::Record(const G4Track* track)
+{
+  Add(track->GetTrackID(), track->GetParentID(), track->GetDefinition()->GetPDGEncoding(),
+      MAVolumeCodes::Get(track->GetLogicalVolumeAtVertex()), track->GetVertexPosition());
+}
+
+void MATrackHistory::Add(G4int tid, G4int pid, G4int pdg, G4int vcode,
+                         const G4ThreeVector& vertex)
+{
+  fTrackID.push_back(tid);
+  fParentID.push_back(pid);
+  fPDG.push_back(pdg);
+  fVertexCode.push_back(vcode);
+  fX.push_back(vertex.x());
+  fY.push_back(vertex.y());
+  fZ.push_back(vertex.z());
+}
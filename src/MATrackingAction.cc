@@ -1,13 +1,23 @@
 #include "MATrackingAction.hh"
+#include "MATrackHistory.hh"
 #include "MATrajectory.hh"
 
 #include "G4Track.hh"
 #include "G4TrackingManager.hh"
 
-MATrackingAction::MATrackingAction() = default;
+MATrackingAction::MATrackingAction(MATrackHistory* history)
+: G4UserTrackingAction()
+, fHistory(history)
+{}
 
 void MATrackingAction::PreUserTrackingAction(const G4Track* aTrack)
 {
+  // one history row per track
+  if(fHistory->IsEnabled())
+  {
+    fHistory->Record(aTrack);
+  }
+
   // Create trajectory for track if requested
   if(fpTrackingManager->GetStoreTrajectory() > 0)
   {
@@ -8,6 +8,7 @@
 #include "G4VisAttributes.hh"
 
 #include "MATrajectory.hh"
+#include "MAVolumeCodes.hh"
 
 G4ThreadLocal G4Allocator<MATrajectory>* myTrajectoryAllocator = nullptr;
 
@@ -19,7 +20,7 @@ MATrajectory::MATrajectory(const G4Track* aTrack)
 , fParticleDefinition{ aTrack->GetDefinition() }
 , fParticleName{ fParticleDefinition->GetParticleName() }
 , fPDGEncoding{ fParticleDefinition->GetPDGEncoding() }
-, fVertexName{ aTrack->GetLogicalVolumeAtVertex()->GetName() }
+, fVertexCode{ MAVolumeCodes::Get(aTrack->GetLogicalVolumeAtVertex()) }
 , fVertexPosition{ aTrack->GetVertexPosition() }
 {
   fPositionRecord->push_back(new G4TrajectoryPoint(aTrack->GetPosition()));
@@ -43,8 +44,8 @@ void MATrajectory::ShowTrajectory(std::ostream& os) const
 
   os << "Particle name : " << fParticleName << "  PDG code : " << fPDGEncoding << G4endl;
 
-  os << "Vertex : " << G4BestUnit(fVertexPosition, "Length") << "  in volume "
-     << fVertexName << G4endl;
+  os << "Vertex : " << G4BestUnit(fVertexPosition, "Length") << "  in volume code "
+     << fVertexCode << G4endl;
 
   os << "  Current trajectory has " << fPositionRecord->size() << " points." << G4endl;
 
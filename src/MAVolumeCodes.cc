@@ -0,0 +1,19 @@
+#include "MAVolumeCodes.hh"
+
+std::vector<G4int>                                MAVolumeCodes::fCodes;
+std::array<std::atomic<G4bool>, MAVolumeCodes::kNumCodes> MAVolumeCodes::fSensitive{};
+
+void MAVolumeCodes::Set(const G4LogicalVolume* lv, G4int code)
+{
+  auto id = static_cast<std::size_t>(lv->GetInstanceID());
+  if(id >= fCodes.size())
+    fCodes.resize(id + 1, -1);
+  fCodes[id] = code;
+}
+
+void MAVolumeCodes::SetSensitive(const G4LogicalVolume* lv)
+{
+  G4int code = Get(lv);
+  if(code >= 0)
+    fSensitive[code].store(true, std::memory_order_relaxed);
+}
@@ -0,0 +1,74 @@
+// Ancestry index: N sibling hits below one long primary to shower chain
+// walk the shared chain once, L + N parent links in all, and every chain
+// still runs from the hit back to the primary.
+
+// standard
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+// us
+#include "MAAncestryIndex.hh"
+
+namespace
+{
+  bool Check(const char* what, double value, double expected, double tolerance)
+  {
+    bool ok = std::abs(value - expected) <= tolerance;
+    std::printf("%-28s %.6g, expected %.6g +- %.3g %s\n", what, value, expected, tolerance,
+                ok ? "" : "FAILED");
+    return ok;
+  }
+
+  // chain of track ids from tid back to 1 through the parents
+  bool Complete(const MAAncestryIndex& index, const std::vector<int>& tid,
+                const std::vector<int>& pid, const std::vector<int>& chain, int first)
+  {
+    int expected = first;
+    for(int position : chain)
+    {
+      if(tid[position] != expected)
+        return false;
+      expected = pid[position];
+    }
+    return expected == 0 && index.Position(first) == chain.front();
+  }
+}  // namespace
+
+int main()
+{
+  bool ok = true;
+
+  // tracks 1..L in one line, then N siblings of track L; in reverse
+  // order, as parents need not come first
+  const int        L = 1000;
+  const int        N = 500;
+  std::vector<int> tid, pid;
+  for(int id = L + N; id >= 1; --id)
+  {
+    tid.push_back(id);
+    pid.push_back(id <= L ? id - 1 : L);
+  }
+
+  MAAncestryIndex index;
+  for(int event = 0; event < 2; ++event)  // tables reused between events
+  {
+    index.Build(tid, pid);
+    bool complete = true;
+    for(int hit = L + 1; hit <= L + N; ++hit)
+      complete = complete && Complete(index, tid, pid, index.Chain(hit), hit);
+    std::printf("event %d\n", event);
+    ok &= Check("  sibling chains complete", complete ? 1.0 : 0.0, 1.0, 0.0);
+    ok &= Check("  links walked", double(index.GetSteps()), double(L + N), 0.0);
+
+    // repeated hits and tracks inside a known chain walk nothing
+    complete = Complete(index, tid, pid, index.Chain(L + 1), L + 1) &&
+               Complete(index, tid, pid, index.Chain(L / 2), L / 2) &&
+               Complete(index, tid, pid, index.Chain(L / 2), L / 2);
+    ok &= Check("  known chains complete", complete ? 1.0 : 0.0, 1.0, 0.0);
+    ok &= Check("  links walked after", double(index.GetSteps()), double(L + N), 0.0);
+    ok &= Check("  unknown track", double(index.Chain(L + N + 1).size()), 0.0, 0.0);
+  }
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,83 @@
+// Hit table: track IDs sharing a home slot are all found again, the
+// table doubles when it would pass half load and keeps every entry, and
+// Clear() leaves an empty table of the same size for the next event.
+
+// standard
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+// us
+#include "MAHitTable.hh"
+
+namespace
+{
+  bool Check(const char* what, double value, double expected, double tolerance)
+  {
+    bool ok = std::abs(value - expected) <= tolerance;
+    std::printf("%-28s %.6g, expected %.6g +- %.3g %s\n", what, value, expected, tolerance,
+                ok ? "" : "FAILED");
+    return ok;
+  }
+
+  // every track ID maps to its own hit index, none to a new slot
+  bool Found(MAHitTable& table, const std::vector<int>& tids)
+  {
+    std::size_t entries = table.GetEntries();
+    for(std::size_t k = 0; k < tids.size(); ++k)
+    {
+      if(table.Hit(tids[k]) != int(k))
+        return false;
+    }
+    return table.GetEntries() == entries;
+  }
+}  // namespace
+
+int main()
+{
+  bool ok = true;
+
+  // track IDs with the same home slot in the initial 64 slots
+  std::vector<int> colliding;
+  for(int tid = 1; colliding.size() < 8; ++tid)
+  {
+    if(((unsigned(tid) * 0x9E3779B1u) & 63u) == ((0x9E3779B1u) & 63u))
+      colliding.push_back(tid);
+  }
+
+  MAHitTable table;
+  for(int event = 0; event < 2; ++event)  // table reused between events
+  {
+    std::printf("event %d\n", event);
+    bool fresh = true;
+    for(std::size_t k = 0; k < colliding.size(); ++k)
+    {
+      int& hit = table.Hit(colliding[k]);
+      fresh    = fresh && hit == -1;
+      hit      = int(k);
+    }
+    ok &= Check("  colliding inserted new", fresh ? 1.0 : 0.0, 1.0, 0.0);
+    ok &= Check("  colliding entries", double(table.GetEntries()), 8.0, 0.0);
+    ok &= Check("  colliding found", Found(table, colliding) ? 1.0 : 0.0, 1.0, 0.0);
+
+    // fill to half load, 32 entries; one more doubles the size once
+    std::vector<int> tids(colliding);
+    for(int tid = 1000; tids.size() < 32; ++tid)
+    {
+      table.Hit(tid) = int(tids.size());
+      tids.push_back(tid);
+    }
+    ok &= Check("  size at half load", double(table.GetSize()), event == 0 ? 64.0 : 128.0, 0.0);
+    table.Hit(5000) = int(tids.size());
+    tids.push_back(5000);
+    ok &= Check("  size past half load", double(table.GetSize()), 128.0, 0.0);
+    ok &= Check("  all found after growth", Found(table, tids) ? 1.0 : 0.0, 1.0, 0.0);
+
+    // next event starts empty, at the grown size
+    table.Clear();
+    ok &= Check("  entries after clear", double(table.GetEntries()), 0.0, 0.0);
+    ok &= Check("  size after clear", double(table.GetSize()), 128.0, 0.0);
+  }
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,112 @@
+// Moments of the alias-method joint muon sampler against numerical
+// integrals of the analytic MuEnergy and MuAngle functors.
+
+// standard
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+// us
+#include "MAMuonJointSampler.hh"
+#include "MAMuonSpectrum.hh"
+
+namespace
+{
+  struct Moments
+  {
+    double meanE    = 0.0;
+    double meanLogE = 0.0;
+    double meanCos  = 0.0;
+    double meanCos2 = 0.0;
+  };
+
+  // midpoint rule on a fine (log E, cos theta) grid
+  Moments Analytic(double depth, bool slant)
+  {
+    const int    nE = 4000, nC = 2000;
+    const double e0 = MAMuonJointSampler::lower_bound;
+    const double e1 = MAMuonJointSampler::upper_bound;
+    const double c0 = MAMuonJointSampler::nearhorizontal;
+    const double c1 = MAMuonJointSampler::fullcosangle;
+    const double dl = std::log(e1 / e0) / nE;
+    const double dc = (c1 - c0) / nC;
+
+    MuAngle angle(depth);
+    Moments m;
+    double  total = 0.0;
+    for(int i = 0; i < nC; ++i)
+    {
+      double   c = c0 + (i + 0.5) * dc;
+      MuEnergy spectrum(slant ? depth / c : depth);
+      double   norm = 0.0, se = 0.0, sl = 0.0;
+      for(int j = 0; j < nE; ++j)
+      {
+        double e = e0 * std::exp((j + 0.5) * dl);
+        double w = spectrum.shape(e) * e;  // dE = E dlogE
+        norm += w;
+        se += w * e;
+        sl += w * std::log(e);
+      }
+      double a = angle(c);
+      total += a;
+      m.meanE += a * se / norm;
+      m.meanLogE += a * sl / norm;
+      m.meanCos += a * c;
+      m.meanCos2 += a * c * c;
+    }
+    m.meanE /= total;
+    m.meanLogE /= total;
+    m.meanCos /= total;
+    m.meanCos2 /= total;
+    return m;
+  }
+
+  bool Check(const char* what, double sampled, double expected, double tolerance)
+  {
+    double rel = std::abs(sampled - expected) / std::abs(expected);
+    std::printf("  %-10s sampled %12.5g  analytic %12.5g  rel. diff %.2e\n", what,
+                sampled, expected, rel);
+    return rel < tolerance;
+  }
+
+  bool Compare(double depth, bool slant)
+  {
+    MAMuonJointSampler::Config cfg;
+    cfg.depth      = depth;
+    cfg.slantDepth = slant;
+    auto sampler   = MAMuonJointSampler::Get(cfg);
+
+    std::mt19937_64                  engine(20210315);
+    std::uniform_real_distribution<> rndm(0.0, 1.0);
+
+    const int n = 4000000;
+    Moments   s;
+    for(int k = 0; k < n; ++k)
+    {
+      double e, c;
+      sampler->Sample(rndm(engine), rndm(engine), rndm(engine), e, c);
+      s.meanE += e;
+      s.meanLogE += std::log(e);
+      s.meanCos += c;
+      s.meanCos2 += c * c;
+    }
+    Moments a = Analytic(depth, slant);
+
+    std::printf("depth %.2f km.w.e., slant depth %s\n", depth, slant ? "on" : "off");
+    bool ok = true;
+    ok &= Check("<E>", s.meanE / n, a.meanE, 1.0e-2);
+    ok &= Check("<log E>", s.meanLogE / n, a.meanLogE, 2.0e-3);
+    ok &= Check("<cos>", s.meanCos / n, a.meanCos, 2.0e-3);
+    ok &= Check("<cos^2>", s.meanCos2 / n, a.meanCos2, 3.0e-3);
+    return ok;
+  }
+}  // namespace
+
+int main()
+{
+  bool ok = true;
+  ok &= Compare(3.4, false);
+  ok &= Compare(3.4, true);
+  ok &= Compare(1.0, true);
+  return ok ? 0 : 1;
+}